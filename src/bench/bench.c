@@ -0,0 +1,295 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * on-target benchmarks. this is a separate firmware image (amigahid-bench) linking the same modules as the real
+ * thing; flash it, attach a terminal to the uart and the results are printed once at startup.
+ *
+ * be warned that it drives the keyboard and mouse lines exactly as the real firmware would, so if it's attached
+ * to an amiga, expect some shift presses, function keys and pointer motion.
+ */
+
+// these reside within the tinyusb sdk and are not part of this project source
+#include "bsp/board.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+
+#include "display/disp_ssd.h"
+#include "display/ugui.h"
+#include "platform/amiga/keyboard_serial_io.h"
+#include "platform/amiga/quad_mouse.h"
+#include "usb_hid.h"
+
+#include "config.h"
+
+// iterations for each of the cheap benchmarks; expensive ones (anything touching the keyboard line) use fewer
+#define BENCH_ITERATIONS        1000
+#define BENCH_ITERATIONS_SLOW   20
+
+// longest to wait for the amiga's power-up handshake before giving up on the keyboard line
+#define BENCH_READY_US          5000000
+
+/**
+ * Print one benchmark result. timings come from the 64-bit microsecond timer; cycle counts are derived from the
+ * system clock so that results from boards clocked differently can still be compared.
+ *
+ * @param name          Name of the benchmark
+ * @param elapsed_us    Total time taken across all iterations
+ * @param iterations    Number of iterations
+ */
+static void bench_report(const char *name, uint64_t elapsed_us, uint32_t iterations)
+{
+    uint64_t cycles = (elapsed_us * (clock_get_hz(clk_sys) / 1000000)) / iterations;
+
+    printf(
+        "[bench] %-32s %10llu ns %10llu cycles (n=%lu)\n",
+        name,
+        (unsigned long long)((elapsed_us * 1000) / iterations),
+        (unsigned long long)cycles,
+        (unsigned long)iterations
+    );
+}
+
+/**
+ * µgui string rendering into the framebuffer, without sending it anywhere
+ */
+static void bench_ugui(void)
+{
+    uint64_t start;
+    uint32_t i;
+
+    if (!disp_ssd_present()) {
+        printf("[bench] no display present; skipping ugui and refresh benchmarks\n");
+        return;
+    }
+
+    start = time_us_64();
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+        UG_PutString(0, 2, "amikb hid:04 ami:20 d");
+    bench_report("ugui string render (21 chars)", time_us_64() - start, BENCH_ITERATIONS);
+}
+
+/**
+ * Display refresh: the time taken to queue a refresh, and the time until the i2c transfer has completed
+ *
+ * @param name          Name of the benchmark
+ * @param first_page    First page to refresh
+ * @param last_page     Last page to refresh
+ */
+static void bench_refresh_range(const char *name, uint8_t first_page, uint8_t last_page)
+{
+    uint64_t start, queued = 0, completed = 0;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_ITERATIONS_SLOW; i++) {
+        while (disp_ssd_busy())
+            tight_loop_contents();
+
+        start = time_us_64();
+        disp_ssd_refresh(first_page, last_page);
+        queued += time_us_64() - start;
+
+        while (disp_ssd_busy())
+            tight_loop_contents();
+        completed += time_us_64() - start;
+    }
+
+    printf("[bench] %s:\n", name);
+    bench_report("  queue", queued, BENCH_ITERATIONS_SLOW);
+    bench_report("  queue to bus idle", completed, BENCH_ITERATIONS_SLOW);
+}
+
+static void bench_refresh(void)
+{
+    disp_ssd_stats_t stats;
+
+    if (!disp_ssd_present())
+        return;
+
+    bench_refresh_range("full refresh (8 pages)", 0, 7);
+    disp_ssd_stats(&stats);
+    printf(
+        "[bench]   %lu bytes, %lu us estimated bus time\n",
+        (unsigned long)stats.frame_bytes,
+        (unsigned long)stats.frame_bus_us
+    );
+
+    bench_refresh_range("partial refresh (2 pages)", 0, 1);
+    disp_ssd_stats(&stats);
+    printf(
+        "[bench]   %lu bytes, %lu us estimated bus time\n",
+        (unsigned long)stats.frame_bytes,
+        (unsigned long)stats.frame_bus_us
+    );
+}
+
+/**
+ * A modifier press or release through translation and onto the keyboard line: the time taken to translate and queue
+ * it, and the time until the transmitter has clocked it out and the amiga has handshaken it
+ */
+static void bench_keyboard_path(void)
+{
+    uint64_t start, queued = 0, sent = 0;
+    uint32_t i;
+
+    // until the amiga has finished its power-up handshake, codes wait behind it
+    start = time_us_64();
+    while (!amiga_ready_us() && ((time_us_64() - start) < BENCH_READY_US))
+        tight_loop_contents();
+
+    if (!amiga_ready_us()) {
+        printf("[bench] no amiga on the keyboard line; skipping keycode benchmark\n");
+        return;
+    }
+
+    for (i = 0; i < (BENCH_ITERATIONS_SLOW * 2); i++) {
+        while (!amiga_queue_idle())
+            tight_loop_contents();
+
+        start = time_us_64();
+        amiga_hid_modifier(NULL, KEYBOARD_MODIFIER_LEFTSHIFT, i & 1);
+        amiga_hid_flush();
+        queued += time_us_64() - start;
+
+        while (!amiga_queue_idle())
+            tight_loop_contents();
+        sent += time_us_64() - start;
+    }
+
+    printf("[bench] keycode to wire code:\n");
+    bench_report("  translate and queue", queued, BENCH_ITERATIONS_SLOW * 2);
+    bench_report("  queue to handshake", sent, BENCH_ITERATIONS_SLOW * 2);
+}
+
+/**
+ * Keyboard report diffing with 0-6 keys held; the report is fed once to press the keys, then repeatedly so that
+ * only the comparison against the previous report is being measured
+ */
+static void bench_report_diff(void)
+{
+    uint8_t report[8] = { 0 };
+    const uint8_t empty[8] = { 0 };
+    char name[40];
+    uint64_t start;
+    uint32_t i;
+    uint8_t held;
+
+    for (held = 0; held <= 6; held++) {
+        for (i = 0; i < held; i++)
+            report[2 + i] = 0x3a + i; // f1 onwards
+
+        hid_keyboard_report(HID_VIRTUAL_DEV_ADDR, 0, report, sizeof(report));
+        amiga_hid_flush();
+
+        start = time_us_64();
+        for (i = 0; i < BENCH_ITERATIONS; i++)
+            hid_keyboard_report(HID_VIRTUAL_DEV_ADDR, 0, report, sizeof(report));
+        snprintf(name, sizeof(name), "report diff, %d key(s) held", held);
+        bench_report(name, time_us_64() - start, BENCH_ITERATIONS);
+
+        hid_keyboard_report(HID_VIRTUAL_DEV_ADDR, 0, empty, sizeof(empty));
+        amiga_hid_flush();
+    }
+}
+
+/**
+ * Quadrature step rate: hand core1 a full-scale delta on both axes and time it being played out
+ */
+static void bench_quadrature(void)
+{
+    amiga_quad_mouse_stats_t before, after;
+    uint64_t start, elapsed;
+
+    amiga_quad_mouse_stats(0, &before);
+    amiga_quad_mouse_set_motion(0, 127, 127, 0);
+    start = time_us_64();
+
+    // core1 counts the motion as requested only once it picks it up (after the divider), so wait for that first,
+    // then for all of it to be stepped out; give up after a second either way
+    do {
+        amiga_quad_mouse_stats(0, &after);
+        elapsed = time_us_64() - start;
+    } while ((after.requested[0] == before.requested[0]) && (elapsed < 1000000));
+
+    while (((after.sent[0] - before.sent[0]) < (after.requested[0] - before.requested[0]))
+        && (elapsed < 1000000)) {
+        amiga_quad_mouse_stats(0, &after);
+        elapsed = time_us_64() - start;
+    }
+
+    printf(
+        "[bench] %-32s %10lu counts in %llu us, %llu counts/s per axis\n",
+        "quadrature step rate",
+        (unsigned long)(after.sent[0] - before.sent[0]),
+        (unsigned long long)elapsed,
+        (unsigned long long)(elapsed ? ((uint64_t)(after.sent[0] - before.sent[0]) * 1000000) / elapsed : 0)
+    );
+}
+
+/**
+ * Gamepad latency: from a report arriving to the joystick lines being set, which has to stay well under 50us. a
+ * virtual gamepad is fed the same report a usb one would send, alternating between the hat pushed up and at rest so
+ * the lines change every time
+ */
+static void bench_gamepad(void)
+{
+    // hat (4 bits, 0-7), padding, then 8 buttons
+    static const uint8_t descriptor[] = {
+        0x05, 0x01, 0x09, 0x05, 0xa1, 0x01,
+        0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42,
+        0x75, 0x04, 0x95, 0x01, 0x81, 0x03,
+        0x05, 0x09, 0x19, 0x01, 0x29, 0x08, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+        0xc0,
+    };
+    const uint8_t reports[2][2] = { { 0x00, 0x01 }, { 0x0f, 0x00 } };   // up with fire 1, then at rest
+    uint64_t start, elapsed, total = 0, worst = 0;
+    uint32_t i;
+
+    hid_virtual_mount(1, descriptor, sizeof(descriptor));
+
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        start = time_us_64();
+        hid_virtual_report(1, reports[i & 1], sizeof(reports[0]));
+        elapsed = time_us_64() - start;
+
+        total += elapsed;
+        if (elapsed > worst)
+            worst = elapsed;
+    }
+
+    bench_report("gamepad report to joystick lines", total, BENCH_ITERATIONS);
+    printf("[bench]   worst %llu us (limit 50 us)\n", (unsigned long long)worst);
+}
+
+int main(void)
+{
+    // tinyusb board init; led, uart, button, usb
+    board_init();
+
+    disp_ssd_init();
+    amiga_init();
+    amiga_quad_mouse_init();
+
+    printf("\n[bench] amigahid-bench, clk_sys %lu Hz\n", (unsigned long)clock_get_hz(clk_sys));
+
+    bench_ugui();
+    bench_refresh();
+    bench_keyboard_path();
+    bench_report_diff();
+    bench_quadrature();
+    bench_gamepad();
+
+    printf("[bench] done\n");
+
+    while (1)
+        tight_loop_contents();
+
+    return 0;
+}
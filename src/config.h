@@ -18,11 +18,30 @@
 #  define INDICATOR_LED PICO_DEFAULT_LED_PIN
 #endif
 
+// amiga models with their own keyboard timing profile (see keyboard_serial_io.c); set AMIGA_MODEL in CMakeLists.txt
+#define AMIGA_MODEL_GENERIC 0
+#define AMIGA_MODEL_A1000   1
+#define AMIGA_MODEL_OCS     2
+#define AMIGA_MODEL_AGA     3
+
+#ifndef AMIGA_MODEL
+#  define AMIGA_MODEL AMIGA_MODEL_GENERIC
+#endif
+
+// video standard of the amiga, for the mouse's per-frame count budget (see quad_mouse.h); set AMIGA_VIDEO in
+// CMakeLists.txt. pal is safe on either; ntsc lets the pointer go a fifth faster, but only on an ntsc amiga
+#define AMIGA_VIDEO_PAL     0
+#define AMIGA_VIDEO_NTSC    1
+
+#ifndef AMIGA_VIDEO
+#  define AMIGA_VIDEO AMIGA_VIDEO_PAL
+#endif
+
 #if defined(BOARD_HIDPICO_REV2)
 #  define HAS_SCREEN
 #  define HAS_KEYBOARD
 #  define HAS_PORT1
-#  define HAS_PORT2
+// port 2's wiring on this board isn't known, so it isn't driven
 
 #  define I2C_PORT      i2c0
 #  define I2C_PIN_SDA   4
@@ -40,6 +59,8 @@
 #  define QM1_AMIGA_B1  22
 #  define QM1_AMIGA_B2  26
 #  define QM1_AMIGA_B3  27
+
+// no pins are known to be free on this board, so there's no native keyboard passthrough or ps/2
 #elif defined(BOARD_HIDPICO_REV4)
 #  define HAS_SCREEN
 #  define HAS_KEYBOARD
@@ -62,8 +83,51 @@
 #  define QM1_AMIGA_B1  11
 #  define QM1_AMIGA_B2  12
 #  define QM1_AMIGA_B3  13
+
+#  define QM2_AMIGA_HQ  21
+#  define QM2_AMIGA_VQ  22
+#  define QM2_AMIGA_H   26
+#  define QM2_AMIGA_V   27
+#  define QM2_AMIGA_B1  20
+#  define QM2_AMIGA_B2  19
+#  define QM2_AMIGA_B3  18
+
+// a real amiga keyboard can be attached here as well (KBD_PASSTHROUGH in CMakeLists.txt); /clk must be the pin after
+// /dat. 14 to 17 aren't routed anywhere on the pcb, so these are wired to the pico's own pads
+#  define KBD_PASS_DAT  14
+#  define KBD_PASS_CLK  15
+
+// or a ps/2 keyboard, in its place, and a ps/2 mouse on the other two unrouted pins (PS2_HOST in CMakeLists.txt);
+// clock is the pin after data
+#  define PS2_KBD_DAT   14
+#  define HAS_PS2_MOUSE
+#  define PS2_MOUSE_DAT 16
 #else
 #  error Board type has not been defined; check cmake command line
 #endif
 
+#if !defined(PLATFORM_AMIGA) && !defined(PLATFORM_ATARI_ST)
+#  error Platform type has not been defined; check cmake command line
+#endif
+
+// the native keyboard passthrough is opt-in, and a ps/2 keyboard takes its pins
+#if defined(KBD_PASSTHROUGH) && defined(PS2_HOST)
+#  error The native keyboard passthrough and the ps/2 keyboard share pins; pick one of KBD_PASSTHROUGH and PS2_HOST
+#endif
+
+#ifdef KBD_PASSTHROUGH
+#  ifndef KBD_PASS_DAT
+#    error This board has no pins for a native keyboard passthrough; remove KBD_PASSTHROUGH
+#  endif
+#  define HAS_KBD_PASSTHROUGH
+#endif
+
+#if defined(PS2_HOST) && !defined(PS2_KBD_DAT)
+#  error This board has no pins for ps/2; remove PS2_HOST
+#endif
+
+// atari st: the ikbd serial line uses the keyboard header, data to the st on kdat and commands from it on kclk
+#define IKBD_ST_TX      KBD_AMIGA_DAT
+#define IKBD_ST_RX      KBD_AMIGA_CLK
+
 #endif // _CONFIG_H
@@ -31,6 +31,7 @@
 #define SSD_BAUD            1000000         // 1MHz; if my estimation is correct, this could achieve 122fps
 #define SSD_ADDR            0x3c            // my board has 0x78 jumper soldered closed on the back but ¯\_(ツ)_/¯
 #define I2C_MAX_TRANSFER    0x400 + 0x20    // 1KB + 32B overhead
+#define SSD_PAGES           (SSD_HEIGHT / 8)
 
 // display transaction structure
 typedef struct
@@ -47,7 +48,11 @@ typedef struct
 static display_transaction_t *current_transaction = NULL,
                              *last_transaction = NULL;
 
-static uint8_t queue_depth = 0;
+// modified by the isr as transactions complete
+static volatile uint8_t queue_depth = 0;
+
+// bus accounting; see disp_ssd_stats()
+static disp_ssd_stats_t stats = { 0 };
 
 /**
  * ssd1306 commands; borrowed from https://github.com/fivdi/pico-i2c-dma ssd1306 example code with thanks.
@@ -121,10 +126,12 @@ static bool _stop = false,
 static int tx_chan = 0,
            rx_chan = 0;
 
-// display things: pixel command buffer (1 command followed by (x * y)/8)
-static uint8_t display_command[1 + ((SSD_WIDTH * SSD_HEIGHT) / 8)];
-// the above buffer has a write command (0x40) followed by the framebuffer; point to the start of the framebuffer
-static uint8_t *framebuffer = &display_command[1];
+// display things: the framebuffer, laid out as the ssd1306 gddram is (a byte per 8-pixel column, page by page)
+static uint8_t framebuffer[(SSD_WIDTH * SSD_HEIGHT) / 8];
+
+// the display's page window, as last set; disp_ssd_init() sets it to the whole display
+static uint8_t window_first = 0,
+               window_last = SSD_PAGES - 1;
 
 // ugui's instance
 static UG_GUI gui;
@@ -356,6 +363,22 @@ static void configure_tx_channel(int tx_chan, uint16_t *write_buffer, size_t wri
     dma_channel_configure(tx_chan, &tx_config, &i2c_get_hw(I2C_PORT)->data_cmd, write_buffer, write_length, true);
 }
 
+/**
+ * Account for an i2c write in the bus statistics: each byte costs nine clocks (eight bits and an ack), and each
+ * transaction another nine for the address plus start and stop conditions.
+ *
+ * @param size_t write_length   Number of bytes being written
+ * @return void
+ */
+static inline void account_transaction(size_t write_length)
+{
+    uint32_t clocks = (9 * (write_length + 1)) + 2;
+
+    stats.transactions++;
+    stats.bytes += write_length + 1;
+    stats.bus_us += (clocks * 1000000ULL) / SSD_BAUD;
+}
+
 /**
  * Perform a read/write transaction to the i2c device
  *
@@ -417,39 +440,19 @@ static void disp_i2c_trans(uint8_t *write_buffer, size_t write_length, uint8_t *
 }
 
 /**
- * Queue an i2c transaction at the end of the transaction list; if no transaction is being processed, dispatch that
- * transaction immediately.
- *
- * @todo it became immediately apparent to me whilst writing that the transaction list methodology won't work for
- *       reading data. truth is, we're never going to read data from the display, so we probably don't need any
- *       of the read handling, so it can likely be removed.
+ * Append a prepared transaction to the end of the transaction list; if no transaction is being processed, dispatch
+ * that transaction immediately.
  *
- * @param uint8_t *write_buffer Pointer of uint8_t buffer to write to the device
- * @param size_t write_length   Length of the write_buffer
- * @param uint8_t *read_buffer  Pointer of uint8_t buffer to read data into
- * @param size_t read_length    Length of data to put into the buffer
+ * @param display_transaction_t *new_transaction    Transaction to queue (ownership passes to the queue)
  * @return void
  */
-void disp_queue_transaction(uint8_t *write_buffer, size_t write_length, uint8_t *read_buffer, size_t read_length)
+static void disp_enqueue(display_transaction_t *new_transaction)
 {
-    display_transaction_t *new_transaction = malloc(sizeof(display_transaction_t));
-    new_transaction->write_buffer = NULL;
-    new_transaction->write_length = write_length;
-    new_transaction->read_buffer = NULL;
-    new_transaction->read_length = read_length;
-    new_transaction->next_transaction = NULL;
-
     uint irqn = (I2C_PORT == i2c0) ? I2C0_IRQ : I2C1_IRQ;
 
-    if (write_length > 0) {
-        new_transaction->write_buffer = malloc(write_length);
-        memcpy(new_transaction->write_buffer, write_buffer, write_length);
-    }
+    new_transaction->next_transaction = NULL;
 
-    if (read_length > 0) {
-        new_transaction->read_buffer = malloc(read_length);
-        memcpy(new_transaction->read_buffer, read_buffer, read_length);
-    }
+    account_transaction(new_transaction->write_length);
 
     queue_depth++;
 
@@ -479,6 +482,63 @@ void disp_queue_transaction(uint8_t *write_buffer, size_t write_length, uint8_t
     irq_set_enabled(irqn, true);
 }
 
+/**
+ * Queue an i2c transaction at the end of the transaction list.
+ *
+ * @todo it became immediately apparent to me whilst writing that the transaction list methodology won't work for
+ *       reading data. truth is, we're never going to read data from the display, so we probably don't need any
+ *       of the read handling, so it can likely be removed.
+ *
+ * @param uint8_t *write_buffer Pointer of uint8_t buffer to write to the device
+ * @param size_t write_length   Length of the write_buffer
+ * @param uint8_t *read_buffer  Pointer of uint8_t buffer to read data into
+ * @param size_t read_length    Length of data to put into the buffer
+ * @return void
+ */
+void disp_queue_transaction(uint8_t *write_buffer, size_t write_length, uint8_t *read_buffer, size_t read_length)
+{
+    display_transaction_t *new_transaction = malloc(sizeof(display_transaction_t));
+    new_transaction->write_buffer = NULL;
+    new_transaction->write_length = write_length;
+    new_transaction->read_buffer = NULL;
+    new_transaction->read_length = read_length;
+
+    if (write_length > 0) {
+        new_transaction->write_buffer = malloc(write_length);
+        memcpy(new_transaction->write_buffer, write_buffer, write_length);
+    }
+
+    if (read_length > 0) {
+        new_transaction->read_buffer = malloc(read_length);
+        memcpy(new_transaction->read_buffer, read_buffer, read_length);
+    }
+
+    disp_enqueue(new_transaction);
+}
+
+/**
+ * Queue a write of a control byte followed by a block of data, without staging the block in a buffer of its own
+ * first (the framebuffer has no room for the control byte in front of an arbitrary page).
+ *
+ * @param uint8_t control   Control byte (0x40 for gddram data, 0x00 for a command stream)
+ * @param uint8_t *data     Bytes to follow the control byte
+ * @param size_t length     Number of bytes at data
+ * @return void
+ */
+static void disp_queue_write(uint8_t control, uint8_t *data, size_t length)
+{
+    display_transaction_t *new_transaction = malloc(sizeof(display_transaction_t));
+    new_transaction->write_buffer = malloc(length + 1);
+    new_transaction->write_length = length + 1;
+    new_transaction->read_buffer = NULL;
+    new_transaction->read_length = 0;
+
+    new_transaction->write_buffer[0] = control;
+    memcpy(&new_transaction->write_buffer[1], data, length);
+
+    disp_enqueue(new_transaction);
+}
+
 /**
  * UGUI callback: Translate ugui pixel draw to the ssd1306 display buffer
  *
@@ -514,13 +574,81 @@ static void ugui_draw_pixel_cb(UG_S16 x, UG_S16 y, UG_COLOUR colour)
 }
 
 /**
- * Redraw the SSD1306 display
+ * Write a byte to a register on the i2c device
+ *
+ * @param uint8_t devregister   Register to write to
+ * @param uint8_t byte          Byte to write
+ * @return void
+ */
+static inline void write_byte(uint8_t devregister, uint8_t byte)
+{
+    // write a byte to a register
+    uint8_t buffer[2] = {devregister, byte};
+    disp_queue_transaction(buffer, 2, NULL, 0);
+}
+
+void disp_ssd_stats(disp_ssd_stats_t *out)
+{
+    *out = stats;
+}
+
+/**
+ * Send a range of framebuffer pages to the display, as a single transaction of the pages behind a gddram control
+ * byte. the display's address pointer goes back to the start of its window after the last byte, so the data lands in
+ * the right place as long as the page window is the range being sent; the window is only set (and the column window
+ * with it, always the whole width so each page is sent in one piece) when the range differs from the last. the
+ * firmware only ever sends the whole display, for which disp_ssd_init() has the window set already.
+ *
+ * @param uint8_t first_page    First page (8-pixel row) to send
+ * @param uint8_t last_page     Last page to send
+ * @return void
+ */
+void disp_ssd_refresh(uint8_t first_page, uint8_t last_page)
+{
+    uint32_t bytes = stats.bytes,
+             bus_us = stats.bus_us;
+
+    if ((first_page > last_page) || (last_page >= SSD_PAGES) || (disp_write == _noop_disp_write))
+        return;
+
+    if ((first_page != window_first) || (last_page != window_last)) {
+        // see disp_ssd_init() re: commands going one byte at a time
+        write_byte(0x80, SET_COLUMN_ADDRESS);
+        write_byte(0x80, 0x00);
+        write_byte(0x80, SSD_WIDTH - 1);
+        write_byte(0x80, SET_PAGE_ADDRESS);
+        write_byte(0x80, first_page);
+        write_byte(0x80, last_page);
+        window_first = first_page;
+        window_last = last_page;
+    }
+
+    // 0x40 (the same bit pattern as SET_DISP_START_LINE): continuation bit clear, d/c# set; the rest is gddram data
+    disp_queue_write(SET_DISP_START_LINE, &framebuffer[first_page * SSD_WIDTH], (last_page - first_page + 1) * SSD_WIDTH);
+
+    stats.frames++;
+    stats.frame_bytes = stats.bytes - bytes;
+    stats.frame_bus_us = stats.bus_us - bus_us;
+}
+
+/**
+ * Redraw the whole SSD1306 display
  *
  * @return void
  */
 static void disp_ssd_update()
 {
-    disp_queue_transaction(display_command, sizeof(display_command), NULL, 0);
+    disp_ssd_refresh(0, SSD_PAGES - 1);
+}
+
+bool disp_ssd_present(void)
+{
+    return disp_write != _noop_disp_write;
+}
+
+bool disp_ssd_busy(void)
+{
+    return queue_depth > 0;
 }
 
 /**
@@ -547,20 +675,6 @@ void _real_disp_write(uint8_t x, uint8_t y, char *message)
     disp_ssd_update();
 }
 
-/**
- * Write a byte to a register on the i2c device
- *
- * @param uint8_t devregister   Register to write to
- * @param uint8_t byte          Byte to write
- * @return void
- */
-static inline void write_byte(uint8_t devregister, uint8_t byte)
-{
-    // write a byte to a register
-    uint8_t buffer[2] = {devregister, byte};
-    disp_queue_transaction(buffer, 2, NULL, 0);
-}
-
 /**
  * Setup the i2c and ssd1306 display ready for use. Without calling this, behaviour is undefined.
  *
@@ -603,9 +717,6 @@ void disp_ssd_init(void)
     for (uint pos = 0; pos < sizeof(init_sequence); pos++)
         write_byte(0x80, init_sequence[pos]);
 
-    // set the command at the beginning of the framebuffer to write out
-    display_command[0] = SET_DISP_START_LINE;
-
     // setup ugui, blank the display
     UG_Init(&gui, ugui_draw_pixel_cb, SSD_WIDTH, SSD_HEIGHT);
     UG_SetBackcolor(C_BLACK);
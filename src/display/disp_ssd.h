@@ -7,10 +7,33 @@
 #ifndef _DISPLAY_DISP_SSD_H
 #define _DISPLAY_DISP_SSD_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/**
+ * i2c traffic generated for the display. byte and time figures include the address byte and start/stop
+ * conditions of each transaction; bus time is an estimate from the configured i2c clock, not a measurement.
+ */
+typedef struct
+{
+    uint32_t transactions;      // i2c transactions queued
+    uint32_t bytes;             // bytes on the wire, address included
+    uint32_t bus_us;            // estimated bus time of all of the above
+    uint32_t frames;            // framebuffer refreshes
+    uint32_t frame_bytes;       // bytes on the wire for the last refresh
+    uint32_t frame_bus_us;      // estimated bus time of the last refresh
+} disp_ssd_stats_t;
+
 void disp_ssd_init(void);
 
+void disp_ssd_refresh(uint8_t first_page, uint8_t last_page);
+
+bool disp_ssd_present(void);
+
+bool disp_ssd_busy(void);
+
+void disp_ssd_stats(disp_ssd_stats_t *out);
+
 extern void (*disp_write)(uint8_t x, uint8_t y, char *message);
 
 #endif // _DISPLAY_DISP_SSD_H
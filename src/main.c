@@ -13,16 +13,15 @@
 #include "tusb.h"
 
 #include "display/disp_ssd.h"
-#include "platform/amiga/keyboard_serial_io.h"
-#include "platform/amiga/quad_mouse.h"
+#include "platform/platform.h"
+#include "ps2/ps2_host.h"
 #include "util/debug_cons.h"
+#include "util/inject.h"
 #include "util/output.h"
 
 #include "config.h"
 #include "tusb_config.h"
-
-// defined within usb_hid.c
-extern void hid_app_task(void);
+#include "usb_hid.h"
 
 // main entry point
 int main(void)
@@ -30,28 +29,43 @@ int main(void)
     // tinyusb board init; led, uart, button, usb
     board_init();
 
-    // initialise the i2c controller and send the init sequence to the display
-    disp_ssd_init();
+    // initialise the usb host stack on the rhport from tusb_config.h; enumeration proceeds from tuh_task() in the
+    // main loop, so nothing below may block
+    tuh_init(BOARD_TUH_RHPORT);
 
-    // say hello, trevor ("hello, trevor")
-    dbgcons_init();
+    // start whichever machine's outputs were built in (PLATFORM_TYPE); nothing here waits on the machine
+    platform_init();
 
-    // initialise the usb host stack on the rhport from tusb_config.h
-    tuh_init(BOARD_TUH_RHPORT);
+#ifdef PS2_HOST
+    // ps/2 keyboard and mouse; whatever is plugged in is reset, and announces itself when it's ready
+    ps2_init();
+#endif
 
-    // we're single arch right now, but in future this should hand off to whatever the
-    // configured arch is
-    amiga_init();
+    // initialise the i2c controller and queue the init sequence for the display
+    disp_ssd_init();
 
-    // start amiga mouse emulation
-    amiga_quad_mouse_init();
+    // say hello, trevor ("hello, trevor")
+    dbgcons_init();
 
     while (1) {
         // run host mode jobs (hotplug events, packet io callbacks)
         tuh_task();
 
-        // amiga keyboard service routine
-        amiga_service();
+#ifdef PS2_HOST
+        // ps/2 keys and motion; before the machine's service, so they're flushed with usb's from this pass
+        ps2_service();
+#endif
+
+        // keyboard (and whatever else) service routine for the machine
+        platform_service();
+
+        // periodic statistics (mouse motion dropped, display bus cost)
+        dbgcons_service();
+
+#ifdef INJECT_UART
+        // keystrokes arriving over the uart from a test script
+        inject_service();
+#endif
     }
 
     return 0;
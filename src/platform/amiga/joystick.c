@@ -0,0 +1,50 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * amiga digital joystick output.
+ *
+ * a joystick shares the mouse's pins: up, down, left and right are the v, h, vq and hq lines, and the fire buttons
+ * are the left, right and middle mouse buttons. the lines are open drain, as the mouse's are; their output latches
+ * stay at 0, and a line is pulled low by making it an output. every line of a port changes in one write, straight
+ * from the usb report, so there's nothing queued between the report and the pins.
+ */
+
+#include "config.h"
+#include "joystick.h"
+#include "quad_mouse.h"
+#include "platform/platform.h"
+
+#include <stdint.h>
+
+#include "hardware/gpio.h"
+
+#define JOY_PINS(up, down, left, right, fire1, fire2, fire3) \
+    { (1u << (up)), (1u << (down)), (1u << (left)), (1u << (right)), (1u << (fire1)), (1u << (fire2)), (1u << (fire3)) }
+
+// each port's pin for each PLATFORM_JOY_* bit, lowest first
+static const uint32_t joy_pins[AQM_PORTS][7] = {
+    JOY_PINS(QM1_AMIGA_V, QM1_AMIGA_H, QM1_AMIGA_VQ, QM1_AMIGA_HQ, QM1_AMIGA_B1, QM1_AMIGA_B2, QM1_AMIGA_B3),
+#ifdef HAS_PORT2
+    JOY_PINS(QM2_AMIGA_V, QM2_AMIGA_H, QM2_AMIGA_VQ, QM2_AMIGA_HQ, QM2_AMIGA_B1, QM2_AMIGA_B2, QM2_AMIGA_B3),
+#endif
+};
+
+void amiga_joystick_set(uint8_t port, uint8_t state)
+{
+    uint32_t mask = 0, low = 0;
+
+    if (port >= AQM_PORTS)
+        return;
+
+    for (uint8_t i = 0; i < 7; i++) {
+        mask |= joy_pins[port][i];
+        if (state & (1 << i))
+            low |= joy_pins[port][i];
+    }
+
+    gpio_set_dir_masked(mask, low);
+}
@@ -0,0 +1,25 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * amiga digital joystick output.
+ */
+
+#ifndef _PLATFORM_AMIGA_JOYSTICK_H
+#define _PLATFORM_AMIGA_JOYSTICK_H
+
+#include <stdint.h>
+
+/**
+ * @brief Set a port's joystick lines. The pins are the mouse's, taken by amiga_quad_mouse_init(); a port shouldn't
+ *        have a mouse and a joystick assigned to it at once.
+ *
+ * @param port      0 for port 1, 1 for port 2; a port the board doesn't have is ignored
+ * @param state     PLATFORM_JOY_* bits which are held
+ */
+void amiga_joystick_set(uint8_t port, uint8_t state);
+
+#endif // _PLATFORM_AMIGA_JOYSTICK_H
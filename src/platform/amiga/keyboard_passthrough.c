@@ -0,0 +1,197 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * real amiga keyboard passthrough.
+ *
+ * a pio statemachine plays the amiga to the native keyboard: it clocks in each code and handshakes it, so the
+ * keyboard's own sync, retransmit and power-up logic all carry on as if it were plugged into the machine. the fifo
+ * interrupt only moves codes into a ring; the main loop decodes them and puts them in the same queue as usb keys, so
+ * nothing in the key queue or caps lock state is ever touched from interrupt context.
+ */
+
+#include "config.h"
+#include "keyboard.h"
+#include "keyboard_passthrough.h"
+#include "keyboard_serial_io.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+
+#ifdef HAS_KBD_PASSTHROUGH
+
+#include "keyboard.pio.h" // generated at compile time
+
+// /clk held low longer than any bit is the keyboard resetting the machine (it holds it for 500ms or more)
+#define KBD_PASS_RESET_US       1000
+// a reset warning with no reset after it; the amiga is let go again
+#define KBD_PASS_WARN_US        10000000
+
+// protocol codes the keyboard sends for itself, rather than for a key
+#define KBD_PASS_RESET_WARNING  0x78
+#define KBD_PASS_PROTOCOL       0xf8    // and above: lost sync, overflow, self test failure, power-up stream
+
+// codes waiting for the main loop; a power of two. the keyboard can't send faster than one every few hundred
+// microseconds, so this covers a long stall
+#define KBD_PASS_RING           32
+
+static PIO pass_pio = pio0;
+static uint pass_sm,
+            pass_offset;
+
+static volatile uint32_t pass_codes = 0;
+static volatile uint8_t ring[KBD_PASS_RING];
+static volatile uint8_t ring_head = 0;      // written only by the interrupt
+static volatile uint8_t ring_tail = 0;      // written only by the main loop
+
+static uint64_t warned_at = 0;              // when a reset warning arrived, 0 for none outstanding
+static uint64_t clk_low_since = 0;
+static bool holding = false;
+
+/**
+ * PIO interrupt: take whatever the native keyboard has sent, for the main loop to pass on
+ */
+static void _passthrough_irq()
+{
+    uint8_t raw, next;
+
+    while (!pio_sm_is_rx_fifo_empty(pass_pio, pass_sm)) {
+        // the lines are active low, and each code arrives as bits 6..0 then 7
+        raw = ~pio_sm_get(pass_pio, pass_sm);
+        pass_codes++;
+
+        // the keyboard has had its handshake either way; if the main loop is this far behind, the key is lost
+        next = (ring_head + 1) & (KBD_PASS_RING - 1);
+        if (next == ring_tail)
+            continue;
+
+        ring[ring_head] = (raw >> 1) | (raw << 7);
+        ring_head = next;
+    }
+}
+
+/**
+ * Pass on one code from the native keyboard
+ *
+ * @param code      Code as the keyboard sent it, bit 7 set for a release
+ */
+static void _passthrough_code(uint8_t code)
+{
+    if (code == KBD_PASS_RESET_WARNING) {
+        // ctrl-amiga-amiga; give the amiga its own warning now, the reset itself follows on /clk
+        if (!warned_at) {
+            warned_at = time_us_64();
+            amiga_assert_reset();
+        }
+        return;
+    }
+
+    if (code >= KBD_PASS_PROTOCOL)
+        return;
+
+    if ((code & 0x7f) == AMIGA_CAPSLOCK) {
+        // the keyboard sends caps lock down as its light comes on, and up as it goes off; amiga_send() wants a
+        // press to toggle, so pass on only a change
+        if (!(code & 0x80) != amiga_caps_lock())
+            amiga_send(AMIGA_CAPSLOCK, false);
+        return;
+    }
+
+    amiga_send(code & 0x7f, code & 0x80);
+}
+
+/**
+ * Put the statemachine back at the start of a code with the lines released
+ */
+static void _passthrough_restart()
+{
+    pio_sm_set_enabled(pass_pio, pass_sm, false);
+    pio_sm_clear_fifos(pass_pio, pass_sm);
+    pio_sm_restart(pass_pio, pass_sm);
+    pio_sm_set_pindirs_with_mask(pass_pio, pass_sm, 0, (1u << KBD_PASS_DAT) | (1u << KBD_PASS_CLK));
+    pio_sm_exec(pass_pio, pass_sm, pio_encode_jmp(pass_offset));
+    pio_sm_set_enabled(pass_pio, pass_sm, true);
+}
+
+void amiga_passthrough_init()
+{
+    pass_sm = pio_claim_unused_sm(pass_pio, true);
+    pass_offset = pio_add_program(pass_pio, &amiga_kbd_recv_program);
+    amiga_kbd_recv_program_init(pass_pio, pass_sm, pass_offset, KBD_PASS_DAT);
+
+    // shared, so that other statemachines on this pio can have interrupts of their own
+    pio_set_irq0_source_enabled(pass_pio, pis_sm0_rx_fifo_not_empty + pass_sm, true);
+    irq_add_shared_handler(PIO0_IRQ_0, _passthrough_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(PIO0_IRQ_0, true);
+}
+
+void amiga_passthrough_service()
+{
+    uint64_t now;
+
+    while (ring_tail != ring_head) {
+        _passthrough_code(ring[ring_tail]);
+        ring_tail = (ring_tail + 1) & (KBD_PASS_RING - 1);
+    }
+
+    now = time_us_64();
+
+    if (!gpio_get(KBD_PASS_CLK)) {
+        if (!clk_low_since)
+            clk_low_since = now;
+
+        // the keyboard is holding the machine in reset; stop listening until it lets go, or the release would be
+        // taken for a bit
+        if (!holding && ((now - clk_low_since) >= KBD_PASS_RESET_US)) {
+            holding = true;
+            pio_sm_set_enabled(pass_pio, pass_sm, false);
+            if (!warned_at)
+                amiga_assert_reset();
+        }
+        return;
+    }
+
+    clk_low_since = 0;
+
+    if (holding) {
+        // it'll go through its power-up again, which the statemachine handshakes like any other codes; anything
+        // still waiting from before the reset is stale
+        holding = false;
+        warned_at = 0;
+        amiga_release_reset();
+        _passthrough_restart();
+        ring_tail = ring_head;
+    } else if (warned_at && ((now - warned_at) >= KBD_PASS_WARN_US)) {
+        warned_at = 0;
+        amiga_release_reset();
+    }
+}
+
+uint32_t amiga_passthrough_codes()
+{
+    return pass_codes;
+}
+
+#else
+
+void amiga_passthrough_init()
+{
+}
+
+void amiga_passthrough_service()
+{
+}
+
+uint32_t amiga_passthrough_codes()
+{
+    return 0;
+}
+
+#endif // HAS_KBD_PASSTHROUGH
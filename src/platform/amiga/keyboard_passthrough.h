@@ -0,0 +1,33 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * real amiga keyboard passthrough: a native keyboard on the KBD_PASS_* pins types alongside usb keyboards.
+ */
+
+#ifndef _PLATFORM_AMIGA_KEYBOARD_PASSTHROUGH_H
+#define _PLATFORM_AMIGA_KEYBOARD_PASSTHROUGH_H
+
+#include <stdint.h>
+
+/**
+ * @brief Start receiving from the native keyboard; does nothing on boards without the pins for one
+ */
+void amiga_passthrough_init();
+
+/**
+ * @brief Pass on codes from the native keyboard and watch it for a reset; call regularly from the main loop
+ */
+void amiga_passthrough_service();
+
+/**
+ * @brief Number of codes received from the native keyboard, including its protocol codes
+ *
+ * @return uint32_t Codes received
+ */
+uint32_t amiga_passthrough_codes();
+
+#endif // _PLATFORM_AMIGA_KEYBOARD_PASSTHROUGH_H
@@ -11,27 +11,164 @@
 #include "config.h"
 #include "keyboard_serial_io.h"
 #include "keyboard.h"
+#include "keymap.h"
+#include "keyboard_passthrough.h"
+#include "macro.h"
+#include "mouse_wheel.h"
 #include "keyboard.pio.h" // generated at compile time
 #include "util/output.h"
 #include "util/debug_cons.h"
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "class/hid/hid.h"
 
-enum _sync_state { IDLE, SYNC };
-// don't optimise variables hit by the timer isr (timer callback?)
-volatile enum _sync_state sync_state = IDLE;
-volatile bool clock_timer_fired = false;
-
 // caps lock will be read by the hid loop
 bool caps_lock = false;
 
+// layout in use; the first one built is the default
+static const amiga_keymap_t *keymap = &amiga_keymaps[0];
+
 enum _keyboard_pin_state { LOW, HIGH };
 
+// keyboard line timing, all in microseconds; bit timing and pacing between codes come from the timing profile
+#define KBD_WARNING_TIMEOUT_US  250000  // amiga must handshake a reset warning within this time
+#define KBD_CLEANUP_TIMEOUT_US  10000000 // amiga may hold /dat low this long after the second warning
+#define KBD_RESET_HOLD_US       500000  // minimum time /clk and /rst are held low for a hard reset
+#define KBD_POLL_US             1000    // polling interval whilst waiting on the amiga
+#define KBD_GAP_POLL_US         100     // polling interval between codes, whilst there's no estimate to go on
+#define KBD_SYNC_TIMEOUT_US     143000  // a sync bit which isn't handshaken within this time is followed by another
+#define KBD_HOST_RESET_MIN_US   5       // shortest low pulse on /clk or /rst from the amiga taken as a reset
+#define KBD_HOST_SETTLE_US      50000   // /clk and /rst high this long after an amiga reset before power-up
+#define KBD_DAT_RELEASE_US      5       // longest /dat takes to come up after we let go of it
+
+// the ack estimate is a moving average over the last (roughly) 2^KBD_ACK_EWMA_SHIFT codes
+#define KBD_ACK_EWMA_SHIFT      3
+
+/**
+ * timing profiles per amiga model (AMIGA_MODEL in config.h). the next code goes out guard_us after the amiga
+ * finishes its handshake, so a fast machine is sent codes as fast as it takes them; fallback_us only comes into it
+ * when no handshake is seen, and is deliberately the same slow pace for every model.
+ */
+typedef struct {
+    uint16_t bit_setup_us;      // /dat settles before /clk is pulsed
+    uint16_t bit_clock_us;      // /clk held low
+    uint16_t bit_hold_us;       // /clk released before the next bit
+    uint16_t guard_us;          // end of the handshake to the start of the next code
+    uint32_t fallback_us;       // end of a code to the start of the next one, when there's no handshake
+} kbd_timing_profile_t;
+
+static const kbd_timing_profile_t timing_profiles[] = {
+    //                      setup clock hold guard fallback
+    [AMIGA_MODEL_GENERIC] = { 20,   20,   50,  200,  5000 },    // the timing this has always used; safe anywhere
+    [AMIGA_MODEL_A1000]   = { 20,   20,   50,  200,  5000 },
+    [AMIGA_MODEL_OCS]     = { 20,   20,   20,  100,  5000 },    // a500, a600, a2000, a3000, cdtv
+    [AMIGA_MODEL_AGA]     = { 20,   20,   20,   50,  5000 },    // a1200, a4000, cd32
+};
+
+static const kbd_timing_profile_t *timing = &timing_profiles[AMIGA_MODEL];
+
+// codes waiting to go out; the amiga's own keyboard has a 10-code buffer, we can afford a little more
+#define KBD_QUEUE_SIZE          64      // must be a power of two
+
+/**
+ * translated key and modifier transitions from one pass of the main loop, across every keyboard, are held here and
+ * queued together by amiga_hid_flush() in canonical order: modifier downs, key ups, key downs, modifier ups. a
+ * shifted key then can't beat its shift down to the amiga, nor a shift up overtake the last key it shifted.
+ */
+#define KBD_BATCH_SIZE          32
+
+enum kbd_batch_class {
+    BATCH_MOD_DOWN,
+    BATCH_KEY_UP,
+    BATCH_KEY_DOWN,
+    BATCH_MOD_UP,
+    BATCH_CLASSES
+};
+
+/**
+ * transmitter state. the keyboard line is driven from timer callbacks rather than by sleeping in amiga_send(), so
+ * nothing which calls in from the usb stack ever waits on the amiga. each state is entered with its pin changes
+ * already made and the callback decides what comes next when its time is up.
+ */
+enum _kbd_state {
+    KBD_IDLE,           // nothing being sent; the next amiga_send() or reset request wakes the transmitter
+    KBD_BIT_DATA,       // /dat set for the current bit
+    KBD_BIT_CLK_LOW,    // /clk pulled low
+    KBD_BIT_CLK_HIGH,   // /clk released
+    KBD_HANDSHAKE,      // /dat released after the last bit; waiting out the gap (or the handshake, for warnings)
+    KBD_RESET_CLEANUP,  // amiga acknowledged the second warning and is holding /dat low whilst it tidies up
+    KBD_RESET_HOLD,     // /clk and /rst held low
+    KBD_HOST_RESET,     // the amiga reset (or power-cycled) itself; waiting for /clk and /rst to settle
+};
+
+/**
+ * power-up sequence, as the real keyboard does it: clock out 1 bits until the amiga handshakes one (its shift
+ * register has filled and it's listening), then initpower, any keys held, and termpower. keys pressed in the
+ * meantime are queued and follow termpower.
+ */
+enum _kbd_powerup {
+    PWR_SYNC,           // clocking out sync bits
+    PWR_INIT,           // in sync; initpower next
+    PWR_TERM,           // termpower next
+    PWR_READY,          // termpower sent; note the time
+    PWR_DONE,
+};
+
+static volatile enum _kbd_state kbd_state = KBD_IDLE;
+static volatile enum _kbd_powerup powerup = PWR_DONE;
+static volatile bool kbd_active = false;    // a transmitter alarm is pending (or running)
+
+// code being transmitted (already rotated into wire order), the next bit to go and how many bits there are
+static uint8_t tx_code = 0,
+               tx_bit = 0,
+               tx_bits = 8;
+
+// reset sequence: requested by the ctrl-amiga-amiga chord, released when it's let go. in_reset covers the whole
+// sequence, from the request until the amiga is let out of reset, and nothing is queued whilst it's set.
+static volatile bool reset_requested = false,
+                     release_requested = false,
+                     in_reset = false;
+static uint8_t reset_warnings = 0;          // reset warnings sent so far in this sequence
+
+// when the current waiting state began, and when the amiga started its handshake (0 for not yet)
+static uint64_t state_entered = 0;
+static volatile uint64_t handshake_start = 0,
+                         handshake_end = 0;
+
+// how long the amiga takes to take a code off the line (end of code to end of handshake), and how often it has
+static volatile uint32_t ack_estimate_us = 0,
+                         acks = 0,
+                         missed_acks = 0;
+
+static volatile uint8_t kbd_queue[KBD_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0,     // written by amiga_send()
+                        queue_tail = 0;     // written by the transmitter
+static volatile bool queue_overflow = false;
+static volatile uint32_t dropped = 0;       // codes lost to a full queue
+
+// transitions waiting for amiga_hid_flush(); codes have bit 7 set for key up
+static uint8_t batch_codes[KBD_BATCH_SIZE];
+static uint8_t batch_classes[KBD_BATCH_SIZE];
+static uint8_t batch_count = 0;
+static uint32_t batch_serial = 1;
+
+// when the last power-up sequence began (boot, or leaving reset) and how long it took to complete
+static uint64_t powerup_start = 0;
+static volatile uint32_t ready_us = 0;
+
+// resets seen from the amiga's side: when /clk and /rst were last pulled low by something other than us (0 for
+// not), whether a reset is waiting for the transmitter to deal with it, and how many there have been
+static volatile uint64_t clk_fall = 0,
+                         rst_fall = 0;
+static volatile bool host_reset = false;
+static volatile uint32_t host_resets = 0;
+
 // @todo this is copy-pasta from quad_mouse; move to util/io.c
 static inline void _keyboard_gpio_set(uint gpio, enum _keyboard_pin_state state)
 {
@@ -45,31 +182,412 @@ static inline void _keyboard_gpio_set(uint gpio, enum _keyboard_pin_state state)
     gpio_set_dir(gpio, GPIO_IN);
 }
 
-/*
-// _.-._.-._ @todo i've not been doing sync correctly for sooooooo long; fix/remove? -._.-._.-
-int64_t sync_timer_cb(alarm_id_t id, void *user_data)
+/**
+ * Convert a keycode and up/down flag to the bit pattern sent on the wire: roll left, with the up flag (bit 7)
+ * becoming the lsb. codes >= 0x80 (initpower and friends) are one-shots and always end up with the lsb set.
+ *
+ * @param keycode   Keycode to send; bit 7 set for codes without an up/down state or for key release
+ * @return uint8_t  Wire code
+ */
+static inline uint8_t _keyboard_wire_code(uint8_t keycode)
 {
-    clock_timer_fired = true;
-    _keyboard_gpio_set(KBD_AMIGA_DAT, LOW);
-    sync_state = SYNC;
+    return (keycode << 1) | (keycode >> 7);
 }
-*/
 
-uint8_t get_modifier_from_hid(hid_keyboard_modifier_bm_t modifier)
+/**
+ * Start clocking out bits, msb first; the remaining bits are sent by subsequent transmitter steps
+ *
+ * @param wire      Bits to send, in wire order
+ * @param bits      Number of bits to send (8 for a code, 1 for a sync bit)
+ * @return int64_t  Time until the next step
+ */
+static int64_t _keyboard_start_bits(uint8_t wire, uint8_t bits)
 {
-    const hid_to_amiga_modifier_t *mapping;
+    tx_code = wire;
+    tx_bit = 0;
+    tx_bits = bits;
 
-    mapping = mapHidModToAmiga;
-    while (mapping->hid_modifier != 0UL) {
-        if (modifier == mapping->hid_modifier) {
-            return mapping->amiga_keycode;
-        }
-        mapping++;
+    kbd_state = KBD_BIT_DATA;
+    _keyboard_gpio_set(KBD_AMIGA_DAT, (tx_code & 0x80) ? LOW : HIGH);
+
+    return timing->bit_setup_us;
+}
+
+/**
+ * Start sending a code
+ *
+ * @param code      Keycode (with bit 7 set for key up)
+ * @return int64_t  Time until the next step
+ */
+static inline int64_t _keyboard_start_code(uint8_t code)
+{
+    return _keyboard_start_bits(_keyboard_wire_code(code), 8);
+}
+
+/**
+ * Begin the power-up sequence; the transmitter works through it ahead of anything queued
+ *
+ * @param start     Time the sequence is measured from
+ */
+static void _keyboard_powerup(uint64_t start)
+{
+    powerup_start = start;
+    powerup = PWR_SYNC;
+}
+
+/**
+ * Pull /clk and /rst low to reset the amiga; the big-box machines only see /clk
+ *
+ * @return int64_t  Time until the next step
+ */
+static int64_t _keyboard_hard_reset(void)
+{
+    // state first, so the edges aren't mistaken for the amiga resetting itself
+    kbd_state = KBD_RESET_HOLD;
+    state_entered = time_us_64();
+
+    // this will hold clk low for at least 500ms, which is useful for a2000/3000/4000 and perhaps cdtv/cd32.
+    // the pause is beneficial for ensuring the reset signal is picked up by the amiga.
+    // (thanks @reinauer for submitting this in issue #31 and testing on your a3000)
+    _keyboard_gpio_set(KBD_AMIGA_DAT, HIGH);
+    _keyboard_gpio_set(KBD_AMIGA_RST, LOW);
+    _keyboard_gpio_set(KBD_AMIGA_CLK, LOW);
+
+    return KBD_POLL_US;
+}
+
+/**
+ * Decide what the idle transmitter does next: a pending reset goes first, then the power-up sequence, then anything
+ * queued
+ *
+ * @return int64_t  Time until the next step, or 0 if there is nothing to do
+ */
+static int64_t _keyboard_next(void)
+{
+    uint8_t code;
+
+    kbd_state = KBD_IDLE;
+
+    if (reset_requested) {
+        // first reset warning; the amiga has to handshake it for the warning to count
+        reset_requested = false;
+        reset_warnings = 1;
+        return _keyboard_start_code(AMIGA_RESET);
+    }
+
+    switch (powerup) {
+        case PWR_SYNC:
+            return _keyboard_start_bits(0x80, 1);
+
+        case PWR_INIT:
+            powerup = PWR_TERM;
+            return _keyboard_start_code(AMIGA_INITPOWER);
+
+        case PWR_TERM:
+            powerup = PWR_READY;
+            return _keyboard_start_code(AMIGA_TERMPOWER);
+
+        case PWR_READY:
+            ready_us = time_us_64() - powerup_start;
+            powerup = PWR_DONE;
+            break;
+
+        case PWR_DONE:
+            break;
+    }
+
+    if (queue_overflow) {
+        // tell the amiga what it missed, the same as the real keyboard does
+        queue_overflow = false;
+        return _keyboard_start_code(AMIGA_OBOFLOW);
+    }
+
+    if (queue_tail != queue_head) {
+        code = kbd_queue[queue_tail];
+        queue_tail = (queue_tail + 1) & (KBD_QUEUE_SIZE - 1);
+        return _keyboard_start_code(code);
     }
 
     return 0;
 }
 
+/**
+ * Advance the transmitter
+ *
+ * @return int64_t  Time until the next step, or 0 to go idle
+ */
+static int64_t _keyboard_step(void)
+{
+    uint64_t now = time_us_64();
+    uint32_t start;
+
+    if (host_reset) {
+        // whatever was on the wire is lost; let go of the lines and wait for the amiga to come back
+        host_reset = false;
+        _keyboard_gpio_set(KBD_AMIGA_DAT, HIGH);
+        _keyboard_gpio_set(KBD_AMIGA_CLK, HIGH);
+
+        kbd_state = KBD_HOST_RESET;
+        state_entered = now;
+        return KBD_POLL_US;
+    }
+
+    switch (kbd_state) {
+        case KBD_IDLE:
+            return _keyboard_next();
+
+        case KBD_BIT_DATA:
+            kbd_state = KBD_BIT_CLK_LOW;
+            _keyboard_gpio_set(KBD_AMIGA_CLK, LOW);
+            return timing->bit_clock_us;
+
+        case KBD_BIT_CLK_LOW:
+            kbd_state = KBD_BIT_CLK_HIGH;
+            _keyboard_gpio_set(KBD_AMIGA_CLK, HIGH);
+            return timing->bit_hold_us;
+
+        case KBD_BIT_CLK_HIGH:
+            if (++tx_bit < tx_bits) {
+                kbd_state = KBD_BIT_DATA;
+                _keyboard_gpio_set(KBD_AMIGA_DAT, ((tx_code << tx_bit) & 0x80) ? LOW : HIGH);
+                return timing->bit_setup_us;
+            }
+
+            // set /dat to input to signal end of code; anything pulling it low from here on is the amiga
+            handshake_start = 0;
+            handshake_end = 0;
+            kbd_state = KBD_HANDSHAKE;
+            state_entered = now;
+            _keyboard_gpio_set(KBD_AMIGA_DAT, HIGH);
+
+            // a quick amiga can start its handshake during the last bit, before the interrupt was looking for it
+            // (or whilst we were holding /dat low ourselves, so there was no edge at all); still low once our own
+            // drive has had time to let go means it's already under way
+            start = time_us_32();
+            while (!gpio_get(KBD_AMIGA_DAT) && ((time_us_32() - start) < KBD_DAT_RELEASE_US))
+                tight_loop_contents();
+            if (!gpio_get(KBD_AMIGA_DAT) && !handshake_start)
+                handshake_start = now;
+            if (reset_warnings || (powerup == PWR_SYNC))
+                return KBD_POLL_US;
+
+            // first look when the amiga usually has it done
+            return ack_estimate_us ? ack_estimate_us : KBD_GAP_POLL_US;
+
+        case KBD_HANDSHAKE:
+            if (!reset_warnings && (powerup == PWR_SYNC)) {
+                // a handshake means the amiga has a full byte and is in step with us; otherwise, another bit
+                if (handshake_start)
+                    powerup = PWR_INIT;
+                else if ((now - state_entered) < KBD_SYNC_TIMEOUT_US)
+                    return KBD_POLL_US;
+
+                return _keyboard_next();
+            }
+
+            if (!reset_warnings) {
+                // once the amiga has let go of /dat it's ready for the next code (or a reset warning, which never
+                // cuts a code short; the amiga would lose sync on a partial one).
+                if (handshake_end) {
+                    if ((now - handshake_end) >= timing->guard_us)
+                        return _keyboard_next();
+
+                    return timing->guard_us - (now - handshake_end);
+                }
+
+                if ((now - state_entered) >= timing->fallback_us) {
+                    missed_acks++;
+                    return _keyboard_next();
+                }
+
+                return KBD_GAP_POLL_US;
+            }
+
+            if (handshake_start) {
+                // handshake of the first warning means the amiga wants to know; send the second
+                if (reset_warnings++ == 1)
+                    return _keyboard_start_code(AMIGA_RESET);
+
+                // handshake of the second warning: the amiga keeps /dat low until it's done tidying up
+                kbd_state = KBD_RESET_CLEANUP;
+                state_entered = now;
+                return KBD_POLL_US;
+            }
+
+            // no handshake means either no amiga listening or one which doesn't care; reset it anyway
+            if ((now - state_entered) >= KBD_WARNING_TIMEOUT_US)
+                return _keyboard_hard_reset();
+
+            return KBD_POLL_US;
+
+        case KBD_RESET_CLEANUP:
+            if (gpio_get(KBD_AMIGA_DAT) || ((now - state_entered) >= KBD_CLEANUP_TIMEOUT_US))
+                return _keyboard_hard_reset();
+
+            return KBD_POLL_US;
+
+        case KBD_RESET_HOLD:
+            // hold for the minimum time, then for as long as the chord is held
+            if (((now - state_entered) < KBD_RESET_HOLD_US) || !release_requested)
+                return KBD_POLL_US;
+
+            _keyboard_gpio_set(KBD_AMIGA_RST, HIGH);
+            _keyboard_gpio_set(KBD_AMIGA_CLK, HIGH);
+
+            // the freshly started machine sees a keyboard with nothing held and caps lock off
+            release_requested = false;
+            reset_warnings = 0;
+            in_reset = false;
+            caps_lock = false;
+
+            // the real keyboard is reset along with the machine and goes through power-up again
+            _keyboard_powerup(now);
+
+            return _keyboard_next();
+
+        case KBD_HOST_RESET:
+            if (!gpio_get(KBD_AMIGA_CLK) || !gpio_get(KBD_AMIGA_RST))
+                state_entered = now;
+
+            if ((now - state_entered) < KBD_HOST_SETTLE_US)
+                return KBD_POLL_US;
+
+            // nothing queued means anything to the freshly started machine, and it has caps lock off. a reset of
+            // our own which was under way is over, too; the chord has to be made again.
+            queue_tail = queue_head;
+            queue_overflow = false;
+            caps_lock = false;
+            reset_warnings = 0;
+            reset_requested = false;
+            release_requested = false;
+            in_reset = false;
+
+            _keyboard_powerup(now);
+
+            return _keyboard_next();
+    }
+
+    return 0;
+}
+
+/**
+ * Timer callback driving the transmitter
+ *
+ * @param id        Alarm id
+ * @param user_data Unused
+ * @return int64_t  Negative delay to reschedule relative to now, or 0 to stop
+ */
+static int64_t _keyboard_alarm_cb(alarm_id_t id, void *user_data)
+{
+    int64_t next = _keyboard_step();
+
+    if (next == 0)
+        kbd_active = false;
+
+    return -next;
+}
+
+/**
+ * Start the transmitter if it isn't already running
+ */
+static void _keyboard_kick(void)
+{
+    uint32_t irq_status = save_and_disable_interrupts();
+
+    if (!kbd_active) {
+        kbd_active = true;
+        // no free alarm slot; the next amiga_send() will try again
+        if (add_alarm_in_us(1, _keyboard_alarm_cb, NULL, true) < 0)
+            kbd_active = false;
+    }
+
+    restore_interrupts(irq_status);
+}
+
+/**
+ * Fold an ack time into the running estimate; the first one seeds it
+ *
+ * @param ack_us    End of code to end of handshake
+ */
+static void _keyboard_learn_ack(uint32_t ack_us)
+{
+    if (!ack_estimate_us)
+        ack_estimate_us = ack_us;
+    else
+        ack_estimate_us = ack_estimate_us - (ack_estimate_us >> KBD_ACK_EWMA_SHIFT) + (ack_us >> KBD_ACK_EWMA_SHIFT);
+
+    acks++;
+}
+
+/**
+ * Time a low pulse on /clk or /rst, flagging an amiga reset when one ends; pulses which began whilst we were
+ * driving the line ourselves are ours, not the amiga's
+ *
+ * @param fall      Start of the current low pulse, 0 if there isn't one (or it's ours)
+ * @param driving   We are driving the line low
+ * @param events    Edge(s) seen
+ */
+static void _keyboard_host_edge(volatile uint64_t *fall, bool driving, uint32_t events)
+{
+    uint64_t now = time_us_64();
+
+    if (events & GPIO_IRQ_EDGE_FALL)
+        *fall = driving ? 0 : now;
+
+    if ((events & GPIO_IRQ_EDGE_RISE) && *fall) {
+        // anything shorter is noise
+        if ((now - *fall) >= KBD_HOST_RESET_MIN_US) {
+            host_reset = true;
+            host_resets++;
+        }
+        *fall = 0;
+    }
+}
+
+/**
+ * GPIO interrupt: catch the amiga's handshake pulse on /dat, and the amiga resetting itself on /clk or /rst
+ *
+ * @param gpio      Pin which changed
+ * @param events    Edge(s) seen
+ */
+static void _keyboard_gpio_irq_cb(uint gpio, uint32_t events)
+{
+    if ((gpio == KBD_AMIGA_DAT) && (kbd_state == KBD_HANDSHAKE)) {
+        if ((events & GPIO_IRQ_EDGE_FALL) && !handshake_start)
+            handshake_start = time_us_64();
+
+        if ((events & GPIO_IRQ_EDGE_RISE) && handshake_start && !handshake_end) {
+            handshake_end = time_us_64();
+            // only ordinary codes; the amiga is in no hurry with sync bits and reset warnings
+            if (!reset_warnings && (powerup != PWR_SYNC))
+                _keyboard_learn_ack(handshake_end - state_entered);
+        }
+    }
+
+    if (gpio == KBD_AMIGA_CLK)
+        _keyboard_host_edge(&clk_fall, (kbd_state == KBD_BIT_CLK_LOW) || (kbd_state == KBD_RESET_HOLD), events);
+
+    if (gpio == KBD_AMIGA_RST)
+        _keyboard_host_edge(&rst_fall, kbd_state == KBD_RESET_HOLD, events);
+
+    if (host_reset)
+        _keyboard_kick();
+}
+
+/**
+ * Look up the amiga keycode for a single modifier bit
+ *
+ * @param modifier  Modifier bit from a boot protocol report
+ * @return uint8_t  Amiga keycode, AMIGA_UNKNOWN if the layout doesn't map it
+ */
+static inline uint8_t _keyboard_modifier_code(const amiga_keymap_t *map, hid_keyboard_modifier_bm_t modifier)
+{
+    if (!modifier)
+        return AMIGA_UNKNOWN;
+
+    return map->modifiers[__builtin_ctz(modifier)];
+}
+
 void amiga_init()
 {
     // setup digital mode, direction and active high/low on /clk, /dat and /rst.
@@ -87,59 +605,124 @@ void amiga_init()
     _keyboard_gpio_set(KBD_AMIGA_CLK, HIGH);
     _keyboard_gpio_set(KBD_AMIGA_RST, HIGH);
 
-    // now the pins are setup, setup the timer callback to maintain keyboard comms in sync.
-    // @todo add_alarm_in_ms() here
+    // watch /dat for the amiga's handshake pulses, and /clk and /rst for it resetting without our say-so
+    gpio_set_irq_enabled_with_callback(KBD_AMIGA_DAT, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, _keyboard_gpio_irq_cb);
+    gpio_set_irq_enabled(KBD_AMIGA_CLK, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+    gpio_set_irq_enabled(KBD_AMIGA_RST, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
 
-    // wait a full second then send initpower, pause 200ms and then termpower. unlike the amiga kbd 6502, we're
-    // not doing anything during this time, so it's just so the computer is happy in the knowledge that we are
-    // here.
-    sleep_ms(1000);
-    amiga_send(AMIGA_INITPOWER, false);
-    sleep_ms(200);
-    amiga_send(AMIGA_TERMPOWER, false);
+    // sync up and send initpower/termpower from the transmitter; nothing here waits on the amiga, so usb
+    // enumeration carries on whilst it boots. time to ready is measured from our own power-up.
+    _keyboard_powerup(0);
+    _keyboard_kick();
 
-    // fin.
+    amiga_macro_init();
+
+    // a native keyboard, if there's one attached, types into the same queue
+    amiga_passthrough_init();
 }
 
-bool amiga_caps_lock()
+uint32_t amiga_ready_us()
 {
-    return caps_lock;
+    return (powerup == PWR_DONE) ? ready_us : 0;
 }
 
-void amiga_hid_send(uint8_t hidcode, bool up)
+uint32_t amiga_host_resets()
 {
-    if (mapHidToAmiga[hidcode] == AMIGA_UNKNOWN) {
-        // ahprintf("[akb] cowardly refusing to send $ff to the amiga\n");
-        return;
-    }
+    return host_resets;
+}
 
-    dbgcons_amiga_key(hidcode, mapHidToAmiga[hidcode], up ? "u" : "d");
+void amiga_kbd_timing(amiga_kbd_timing_t *out)
+{
+    out->ack_estimate_us = ack_estimate_us;
+    out->acks = acks;
+    out->missed_acks = missed_acks;
+    out->dropped = dropped;
+}
+
+const amiga_keymap_t *amiga_keymap_find(const char *name)
+{
+    for (uint8_t i = 0; i < amiga_keymap_count; i++)
+        if (strcmp(amiga_keymaps[i].name, name) == 0)
+            return &amiga_keymaps[i];
 
-    amiga_send(mapHidToAmiga[hidcode], up);
+    return NULL;
 }
 
-void amiga_hid_modifier(hid_keyboard_modifier_bm_t modifier, bool up)
+bool amiga_keymap_select(const char *name)
 {
-    uint8_t amiga_code;
-    amiga_code = get_modifier_from_hid(modifier);
+    const amiga_keymap_t *map = amiga_keymap_find(name);
 
-    // @todo indicate the modifier state in dbgcons, somehow
-    dbgcons_amiga_key(0, amiga_code, up ? "u" : "d");
+    if (map == NULL)
+        return false;
 
-    amiga_send(amiga_code, up);
+    keymap = map;
+    return true;
 }
 
-void amiga_send(uint8_t keycode, bool up)
+const char *amiga_keymap_name()
+{
+    return keymap->name;
+}
+
+uint8_t amiga_queue_free()
+{
+    // one slot is always left empty to tell a full queue from an empty one
+    return (KBD_QUEUE_SIZE - 1) - ((queue_head - queue_tail) & (KBD_QUEUE_SIZE - 1));
+}
+
+bool amiga_queue_idle()
+{
+    return (queue_head == queue_tail) && !kbd_active;
+}
+
+bool amiga_caps_lock()
+{
+    return caps_lock;
+}
+
+/**
+ * Hold a translated transition for the next amiga_hid_flush()
+ *
+ * @param amiga_code    Amiga keycode
+ * @param up            true if key release, false if press
+ * @param modifier      true for a modifier, false for any other key
+ */
+static void _keyboard_batch(uint8_t amiga_code, bool up, bool modifier)
 {
-    uint8_t bit_position, bit_mask = 0x80, sendcode;
-    static bool ctrl = false, lamiga = false, ramiga = false, in_reset = false;
+    // the same key going the other way in one batch would be reordered into nonsense (an up ahead of its down);
+    // let what's held so far go first. likewise if the batch is full.
+    for (uint8_t i = 0; i < batch_count; i++) {
+        if ((batch_codes[i] & 0x7f) == amiga_code) {
+            amiga_hid_flush();
+            break;
+        }
+    }
+    if (batch_count == KBD_BATCH_SIZE)
+        amiga_hid_flush();
+
+    batch_codes[batch_count] = amiga_code | (up ? 0x80 : 0x00);
+    batch_classes[batch_count] = modifier
+        ? (up ? BATCH_MOD_UP : BATCH_MOD_DOWN)
+        : (up ? BATCH_KEY_UP : BATCH_KEY_DOWN);
+    batch_count++;
+}
 
+/**
+ * Check a code on its way into the queue, and apply the caps lock rules to it
+ *
+ * @param keycode   Keycode, rewritten with bit 7 set for key up
+ * @param up        true if key release, false if press
+ * @return true     Queue it
+ * @return false    Drop it
+ */
+static bool _keyboard_prepare(uint8_t *keycode, bool up)
+{
     // we don't care about caps lock coming up; ignore it
-    if ((keycode == AMIGA_CAPSLOCK) && up)
-        return;
+    if ((*keycode == AMIGA_CAPSLOCK) && up)
+        return false;
 
     // check for caps lock going down and toggle; rewrite the 'up' parameter
-    if (keycode == AMIGA_CAPSLOCK) {
+    if (*keycode == AMIGA_CAPSLOCK) {
         // amiga caps lock is odd; when it's on, it sends down code but no up, and vice versa when it comes off
         up = caps_lock;
         caps_lock = !caps_lock;
@@ -147,90 +730,157 @@ void amiga_send(uint8_t keycode, bool up)
         // ahprintf("[akb] caps lock %s\n", caps_lock ? "ON" : "OFF");
     }
 
-    if (keycode == AMIGA_CTRL)
-        ctrl = !up;
-    if (keycode == AMIGA_LAMIGA)
-        lamiga = !up;
-    if (keycode == AMIGA_RAMIGA)
-        ramiga = !up;
+    ahtrace("trace ami %02x %s wire %02x\n", *keycode, up ? "u" : "d", _keyboard_wire_code(*keycode | (up ? 0x80 : 0x00)));
+    *keycode |= up ? 0x80 : 0x00;
 
-    if ((ctrl && lamiga && ramiga) && !in_reset) {
-        in_reset = true;
-        amiga_assert_reset();
+    return true;
+}
+
+/**
+ * Put a code on the queue; interrupts must be disabled
+ *
+ * @param keycode   Keycode, bit 7 set for key up
+ */
+static void _keyboard_enqueue(uint8_t keycode)
+{
+    uint8_t next_head = (queue_head + 1) & (KBD_QUEUE_SIZE - 1);
+
+    if (next_head == queue_tail) {
+        // full; drop it and let the amiga know once there's room
+        queue_overflow = true;
+        dropped++;
+    } else {
+        kbd_queue[queue_head] = keycode;
+        queue_head = next_head;
     }
+}
+
+void amiga_hid_send(const amiga_keymap_t *map, uint8_t hidcode, bool up)
+{
+    uint8_t amiga_code = (map ? map : keymap)->keys[hidcode];
 
-    if (in_reset && !(ctrl && lamiga && ramiga)) {
-        in_reset = false;
-        amiga_release_reset();
+    if (amiga_code == AMIGA_UNKNOWN) {
+        // ahprintf("[akb] cowardly refusing to send $ff to the amiga\n");
+        return;
     }
 
+    dbgcons_amiga_key(hidcode, amiga_code, up ? "u" : "d");
+
+    _keyboard_batch(amiga_code, up, false);
+}
+
+void amiga_hid_modifier(const amiga_keymap_t *map, hid_keyboard_modifier_bm_t modifier, bool up)
+{
+    uint8_t amiga_code = _keyboard_modifier_code(map ? map : keymap, modifier);
+
+    if (amiga_code == AMIGA_UNKNOWN)
+        return;
+
+    // @todo indicate the modifier state in dbgcons, somehow
+    dbgcons_amiga_key(0, amiga_code, up ? "u" : "d");
+
+    _keyboard_batch(amiga_code, up, true);
+}
+
+void amiga_hid_flush()
+{
+    uint8_t codes[KBD_BATCH_SIZE], count = 0, keycode;
+    uint32_t irq_status;
+
+    if (!batch_count)
+        return;
+
+    // canonical order; arrival order within each class. see amiga_send() about reset: a batch which isn't going to be
+    // sent doesn't get as far as caps lock or the trace
+    for (uint8_t class = 0; !in_reset && (class < BATCH_CLASSES); class++) {
+        for (uint8_t i = 0; i < batch_count; i++) {
+            keycode = batch_codes[i] & 0x7f;
+            if ((batch_classes[i] == class) && _keyboard_prepare(&keycode, batch_codes[i] & 0x80))
+                codes[count++] = keycode;
+        }
+    }
+    batch_count = 0;
+    if (!++batch_serial)
+        batch_serial = 1;
+
+    if (!count)
+        return;
+
+    // one trip into the queue for the lot, and one kick of the transmitter
+    irq_status = save_and_disable_interrupts();
+    for (uint8_t i = 0; i < count; i++)
+        _keyboard_enqueue(codes[i]);
+    restore_interrupts(irq_status);
+
+    _keyboard_kick();
+}
+
+uint32_t amiga_hid_batch()
+{
+    return batch_serial;
+}
+
+void amiga_send(uint8_t keycode, bool up)
+{
+    uint32_t irq_status;
+
     /**
-     * send the keycode to the amiga
-     *
      * @todo hook up real keyboard to logic analyser and check if keycodes are sent whilst reset is being asserted
      * (or reverse engineer the keyboard binary from the 6571); this avoids sending keycodes whilst in reset, but
      * it would be good to verify that this is the situation for the original controller
      */
-    if (!in_reset) {
-        // copy input code, roll left, move msb to lsb
-        sendcode = keycode | (up ? 0x80 : 0x00);
-        sendcode <<= 1;
-        if (up || (keycode & 0x80))
-            sendcode |= 1;
-
-        for (bit_position = 0; bit_position < 8; bit_position++) {
-            if (sendcode & bit_mask)
-                _keyboard_gpio_set(KBD_AMIGA_DAT, LOW);
-            else
-                _keyboard_gpio_set(KBD_AMIGA_DAT, HIGH);
-
-            // hold /dat for 20us before pulsing /clk, then wait 50us before next bit
-            sleep_us(20);
-            _keyboard_gpio_set(KBD_AMIGA_CLK, LOW);
-            sleep_us(20);
-            _keyboard_gpio_set(KBD_AMIGA_CLK, HIGH);
-            sleep_us(50); // @todo should be 20?
+    if (in_reset)
+        return;
 
-            // shift the bit pattern for next iteration
-            bit_mask >>= 1;
-        }
-    }
+    if (!_keyboard_prepare(&keycode, up))
+        return;
 
-    // set /dat to input for 5ms to signal end of key
-    _keyboard_gpio_set(KBD_AMIGA_DAT, HIGH);
-    sleep_ms(5);
+    irq_status = save_and_disable_interrupts();
+    _keyboard_enqueue(keycode);
+    restore_interrupts(irq_status);
 
-    // @todo we _should_ be checking that the amiga has acked the code by watching /dat
-    // for a lwo pulse. according to adcd2.1, while the computer cannot detect
-    // out-of-sync, the keyboard can by looking for the pulse, sending $f9 then the
-    // repeated code.
+    _keyboard_kick();
 }
 
 void amiga_assert_reset()
 {
+    uint32_t irq_status;
+
     // ahprintf("[akb] *** RESET BEING ASSERTED ***\n");
-    _keyboard_gpio_set(KBD_AMIGA_RST, LOW);
+    ahtrace("trace ami reset assert\n");
 
-    // this will hold clk low for 500ms, which is useful for a2000/3000/4000 and perhaps cdtv/cd32.
-    // the pause is beneficial for ensuring the reset signal is picked up by the amiga.
-    // (thanks @reinauer for submitting this in issue #31 and testing on your a3000)
-    _keyboard_gpio_set(KBD_AMIGA_CLK, LOW);
-    sleep_us(500000);
+    irq_status = save_and_disable_interrupts();
+    release_requested = false;
+    if (!in_reset) {
+        // the real controller drops its buffer when it goes into reset; whatever was waiting is discarded rather
+        // than being sent ahead of the warning (or to the machine after it restarts)
+        in_reset = true;
+        reset_requested = true;
+        queue_tail = queue_head;
+        queue_overflow = false;
+    }
+    restore_interrupts(irq_status);
+
+    _keyboard_kick();
 }
 
 void amiga_release_reset()
 {
     // ahprintf("[akb] *** RESET BEING RELEASED ***\n");
-    _keyboard_gpio_set(KBD_AMIGA_RST, HIGH);
-    _keyboard_gpio_set(KBD_AMIGA_CLK, HIGH);
+    ahtrace("trace ami reset release\n");
+
+    // the transmitter lets go once the minimum hold time has passed
+    release_requested = true;
+    _keyboard_kick();
 }
 
 void amiga_service()
 {
-    if ((sync_state == SYNC) && clock_timer_fired) {
-        // @todo THIS IS WRONG
-        _keyboard_gpio_set(KBD_AMIGA_RST, HIGH);
-        sync_state = IDLE;
-        clock_timer_fired = false;
-    }
+    // the keyboard line is driven entirely from timer callbacks. what's left is to pass on the transitions from
+    // this round of usb reports and whatever the native keyboard has sent, keep a macro fed, and send a wheel notch
+    // if the line is free.
+    amiga_hid_flush();
+    amiga_passthrough_service();
+    amiga_macro_service();
+    amiga_wheel_service();
 }
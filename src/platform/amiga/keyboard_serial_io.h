@@ -15,14 +15,73 @@
 #include <stdbool.h>
 
 #include "class/hid/hid.h"
+#include "keymap.h"
+
+/**
+ * keyboard line pacing, as learnt from the amiga's handshakes
+ */
+typedef struct {
+    uint32_t ack_estimate_us;   // running estimate of end of code to end of handshake; 0 until the first
+    uint32_t acks;              // codes the amiga has handshaken
+    uint32_t missed_acks;       // codes which went unhandshaken, and were paced by the fallback profile instead
+    uint32_t dropped;           // codes thrown away because the queue was full
+} amiga_kbd_timing_t;
 
 /**
  * @brief Setup Amiga keyboard communication
  *
- * Starts clocks, sets up ISRs and sends init codes to the host
+ * Sets up the pins and ISRs and starts the power-up sequence (sync, INITPOWER, TERMPOWER) in the background;
+ * returns immediately. Anything sent before the sequence completes is held until it has.
  */
 void amiga_init();
 
+/**
+ * @brief How long the last power-up sequence took to complete
+ *
+ * @return uint32_t Microseconds from power-up (or leaving reset) until TERMPOWER was sent, 0 if still in progress
+ */
+uint32_t amiga_ready_us();
+
+/**
+ * @brief Number of times the Amiga has been seen resetting itself (reset button, reboot, power cycle). Each one
+ *        discards anything queued and runs the power-up sequence again once the Amiga is back.
+ *
+ * @return uint32_t Amiga-side resets since power-up
+ */
+uint32_t amiga_host_resets();
+
+/**
+ * @brief Take a copy of the keyboard pacing figures
+ *
+ * @param out   Where to put them
+ */
+void amiga_kbd_timing(amiga_kbd_timing_t *out);
+
+/**
+ * @brief Find a keyboard layout by name
+ *
+ * @param name      Layout name
+ * @return const amiga_keymap_t*    Layout, or NULL if there's no such layout
+ */
+const amiga_keymap_t *amiga_keymap_find(const char *name);
+
+/**
+ * @brief Switch the default keyboard layout (used by keyboards without one of their own); takes effect from the
+ *        next key sent
+ *
+ * @param name      Layout name (us, uk, de, fr, ... as built from platform/amiga/keymaps)
+ * @return true     Layout selected
+ * @return false    No layout of that name; the current one is kept
+ */
+bool amiga_keymap_select(const char *name);
+
+/**
+ * @brief Get the name of the keyboard layout in use
+ *
+ * @return const char*  Layout name
+ */
+const char *amiga_keymap_name();
+
 /**
  * @brief Get the caps lock status
  *
@@ -32,23 +91,40 @@ void amiga_init();
 bool amiga_caps_lock();
 
 /**
- * @brief Send a HID keycode to the Amiga, translating along the way
+ * @brief Send a HID keycode to the Amiga, translating along the way. It's held with the rest of this round's
+ *        transitions until amiga_hid_flush().
  *
+ * @param map       Layout to translate with, or NULL for the default
  * @param hidcode   HID keycode to send
  * @param up        true if key release, false if press
  */
-void amiga_hid_send(uint8_t hidcode, bool up);
+void amiga_hid_send(const amiga_keymap_t *map, uint8_t hidcode, bool up);
 
 /**
- * @brief Send a modifier keycode to the Amiga, translating along the way
+ * @brief Send a modifier keycode to the Amiga, translating along the way. It's held with the rest of this round's
+ *        transitions until amiga_hid_flush().
  *
+ * @param map       Layout to translate with, or NULL for the default
  * @param modifier  Modifier being sent
  * @param up        Up or down? true if release, false if press
  */
-void amiga_hid_modifier(hid_keyboard_modifier_bm_t modifier, bool up);
+void amiga_hid_modifier(const amiga_keymap_t *map, hid_keyboard_modifier_bm_t modifier, bool up);
 
 /**
- * @brief Send a keycode to the Amiga
+ * @brief Queue the held key and modifier transitions: modifier downs, then key ups, key downs and modifier ups.
+ *        amiga_service() does this once per pass of the main loop.
+ */
+void amiga_hid_flush();
+
+/**
+ * @brief Identify the batch being collected; it changes with every flush
+ *
+ * @return uint32_t Batch serial number, never 0
+ */
+uint32_t amiga_hid_batch();
+
+/**
+ * @brief Queue a keycode to send to the Amiga; returns immediately, the code is sent from a timer callback
  *
  * @param keycode   Keycode to send to the host
  * @param up        Boolean press status; if true, code is & 0x80 before rol
@@ -56,12 +132,30 @@ void amiga_hid_modifier(hid_keyboard_modifier_bm_t modifier, bool up);
 void amiga_send(uint8_t keycode, bool up);
 
 /**
- * @brief Assert the reset signal - Amiga will hold in reset until released
+ * @brief Number of codes which can be queued before the queue overflows
+ *
+ * @return uint8_t  Free queue slots
+ */
+uint8_t amiga_queue_free();
+
+/**
+ * @brief Check whether everything queued has been sent
+ *
+ * @return true     Queue empty and the transmitter has nothing in hand
+ * @return false    Codes are still on their way
+ */
+bool amiga_queue_idle();
+
+/**
+ * @brief Request a reset - the Amiga is sent the reset warning, given its chance to clean up, then held in reset
+ *        until released. Returns immediately; the sequence runs from a timer callback. Codes still queued are
+ *        discarded and nothing more is queued until the Amiga is let out of reset; the warning follows whatever
+ *        code is on the wire as soon as the Amiga has acknowledged it.
  */
 void amiga_assert_reset();
 
 /**
- * @brief Release reset signal - Amiga will initiate startup once released
+ * @brief Release reset signal - Amiga will initiate startup once released (and held for at least 500ms)
  */
 void amiga_release_reset();
 
@@ -0,0 +1,28 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * hid to amiga keymaps. the tables are generated at build time from the layout sources in keymaps/ by
+ * keymaps/compile_keymaps.py, and live in ram so the lookup never waits on flash.
+ */
+
+#ifndef _PLATFORM_AMIGA_KEYMAP_H
+#define _PLATFORM_AMIGA_KEYMAP_H
+
+#include <stdint.h>
+
+// the amiga's platform_keymap_t (see platform/platform.h)
+typedef struct platform_keymap {
+    const char *name;           // layout name, as in its source
+    const uint8_t *keys;        // [256] indexed by hid keycode; AMIGA_UNKNOWN for keys the amiga doesn't have
+    const uint8_t *modifiers;   // [8] indexed by bit number in the boot protocol modifier byte
+} amiga_keymap_t;
+
+// every layout built in; the first is the one selected at power-up
+extern const amiga_keymap_t amiga_keymaps[];
+extern const uint8_t amiga_keymap_count;
+
+#endif // _PLATFORM_AMIGA_KEYMAP_H
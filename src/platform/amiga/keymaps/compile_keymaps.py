@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+#
+# this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+# please locate the full source at https://github.com/borb/amigahid-pico
+#
+# released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+# please find the complete license text at https://spdx.org/licenses/EPL-2.0
+#
+# keymap compiler: turns the *.keymap layout sources into flat, directly indexed hid -> amiga tables (see
+# platform/amiga/keymap.h). run by the build; the default layout always comes out first.
+#
+# usage: compile_keymaps.py -o keymaps.c [-d default] layout.keymap [...]
+
+import argparse
+import os
+import re
+import sys
+
+# bit order of the modifier byte in a boot protocol report
+MODIFIERS = [
+    'leftctrl', 'leftshift', 'leftalt', 'leftgui',
+    'rightctrl', 'rightshift', 'rightalt', 'rightgui',
+]
+
+UNKNOWN = 'AMIGA_UNKNOWN'
+
+
+class KeymapError(Exception):
+    pass
+
+
+def amiga_code(token, where):
+    # either a symbol from keyboard.h (resolved by the compiler, not here) or a number
+    if re.fullmatch(r'AMIGA_[A-Z0-9]+', token):
+        return token
+    try:
+        value = int(token, 0)
+    except ValueError:
+        raise KeymapError(f'{where}: "{token}" is neither an AMIGA_ keycode nor a number')
+    if not 0 <= value <= 0xff:
+        raise KeymapError(f'{where}: amiga keycode {token} out of range')
+    return f'0x{value:02x}'
+
+
+def parse(path):
+    layout = {'name': None, 'base': None, 'keys': {}, 'mods': {}, 'path': path}
+
+    with open(path) as source:
+        for lineno, line in enumerate(source, 1):
+            where = f'{path}:{lineno}'
+            words = line.split('#', 1)[0].split()
+            if not words:
+                continue
+
+            if words[0] in ('name', 'base') and len(words) == 2:
+                layout[words[0]] = words[1]
+            elif words[0] == 'key' and len(words) == 3:
+                try:
+                    hid = int(words[1], 0)
+                except ValueError:
+                    raise KeymapError(f'{where}: hid keycode "{words[1]}" is not a number')
+                if not 0 <= hid <= 0xff:
+                    raise KeymapError(f'{where}: hid keycode {words[1]} out of range')
+                layout['keys'][hid] = amiga_code(words[2], where)
+            elif words[0] == 'mod' and len(words) == 3:
+                if words[1] not in MODIFIERS:
+                    raise KeymapError(f'{where}: unknown modifier "{words[1]}"')
+                layout['mods'][MODIFIERS.index(words[1])] = amiga_code(words[2], where)
+            else:
+                raise KeymapError(f'{where}: can\'t make sense of "{line.strip()}"')
+
+    if layout['name'] is None:
+        layout['name'] = os.path.splitext(os.path.basename(path))[0]
+    if not re.fullmatch(r'[a-z0-9_]+', layout['name']):
+        raise KeymapError(f'{path}: layout name "{layout["name"]}" must be lowercase letters, digits and _')
+
+    return layout
+
+
+def resolve(name, layouts, seen=()):
+    # flatten a layout onto its base (and its base's base...)
+    if name in seen:
+        raise KeymapError(f'layout "{name}" is its own base')
+    if name not in layouts:
+        raise KeymapError(f'no such layout "{name}"')
+
+    layout = layouts[name]
+    keys = [UNKNOWN] * 256
+    mods = [UNKNOWN] * 8
+
+    if layout['base'] is not None:
+        keys, mods = resolve(layout['base'], layouts, seen + (name,))
+
+    for hid, code in layout['keys'].items():
+        keys[hid] = code
+    for bit, code in layout['mods'].items():
+        mods[bit] = code
+
+    return keys, mods
+
+
+def table(name, codes, per_line):
+    lines = [f'static const uint8_t __not_in_flash("keymap_{name}") {name}[{len(codes)}] = {{']
+    for pos in range(0, len(codes), per_line):
+        row = ''.join(f'{code + ",":<17}' for code in codes[pos:pos + per_line]).rstrip()
+        lines.append(f'    {row} // 0x{pos:02x}')
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='compile amigahid-pico keymaps')
+    parser.add_argument('-o', '--output', required=True, help='c source to write')
+    parser.add_argument('-d', '--default', default='us', help='layout selected at power-up')
+    parser.add_argument('sources', nargs='+', help='*.keymap layout sources')
+    args = parser.parse_args()
+
+    try:
+        layouts = {}
+        for path in args.sources:
+            layout = parse(path)
+            if layout['name'] in layouts:
+                raise KeymapError(f'{path}: layout "{layout["name"]}" is already defined')
+            layouts[layout['name']] = layout
+
+        if args.default not in layouts:
+            raise KeymapError(f'default layout "{args.default}" is not among the sources')
+
+        order = [args.default] + sorted(name for name in layouts if name != args.default)
+        resolved = {name: resolve(name, layouts) for name in order}
+    except (KeymapError, OSError) as error:
+        sys.exit(f'compile_keymaps: {error}')
+
+    out = [
+        '// generated by compile_keymaps.py from '
+        + ', '.join(os.path.basename(path) for path in args.sources) + '; do not edit',
+        '',
+        '#include <stdint.h>',
+        '',
+        '#include "pico.h"',
+        '',
+        '#include "platform/amiga/keyboard.h"',
+        '#include "platform/amiga/keymap.h"',
+        '',
+    ]
+
+    for name in order:
+        keys, mods = resolved[name]
+        out.append(table(f'keys_{name}', keys, 8))
+        out.append('')
+        out.append(table(f'mods_{name}', mods, 8))
+        out.append('')
+
+    # the layout descriptors are in ram too, as the hot path goes through them
+    out.append('const amiga_keymap_t __not_in_flash("keymap") amiga_keymaps[] = {')
+    for name in order:
+        out.append(f'    {{ "{name}", keys_{name}, mods_{name} }},')
+    out.append('};')
+    out.append('')
+    out.append(f'const uint8_t amiga_keymap_count = {len(order)};')
+    out.append('')
+
+    with open(args.output, 'w') as output:
+        output.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,387 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * keyboard macros.
+ *
+ * a playing macro is fed into the keyboard queue from the main loop whenever there's room, and the transmitter
+ * sends it as fast as the amiga handshakes; nothing waits. a pause waits for everything before it to be sent
+ * first, so it's a pause the amiga actually sees.
+ */
+
+#include "macro.h"
+#include "keyboard.h"
+#include "keyboard_serial_io.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+// saved macros live in the last sector of flash, well clear of the firmware
+#define MACRO_FLASH_OFFSET  (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define MACRO_FLASH_MAGIC   0x3143414d  // "MAC1"
+
+// longest to hold everything up waiting for the keyboard line (see _macro_wait()); draining a full queue takes far less
+#define MACRO_WAIT_US       500000
+
+typedef struct {
+    uint32_t magic;
+    uint16_t count;         // macro records which follow
+    uint16_t steps;         // steps which follow the records, for every macro in turn
+} macro_flash_header_t;
+
+typedef struct {
+    uint8_t modifier;
+    uint8_t keycode;
+    uint16_t length;
+} macro_flash_record_t;
+
+_Static_assert(
+    sizeof(macro_flash_header_t) + (MACRO_MAX * sizeof(macro_flash_record_t)) + (MACRO_POOL_STEPS * sizeof(uint16_t))
+        <= FLASH_SECTOR_SIZE,
+    "saved macros don't fit in a flash sector"
+);
+
+/**
+ * built-in macros, always present. for example, to type "dir" and return on f12:
+ *
+ * static const uint16_t macro_dir[] = {
+ *     MACRO_DOWN(AMIGA_D), MACRO_UP(AMIGA_D), MACRO_DOWN(AMIGA_I), MACRO_UP(AMIGA_I),
+ *     MACRO_DOWN(AMIGA_R), MACRO_UP(AMIGA_R), MACRO_DOWN(AMIGA_RETURN), MACRO_UP(AMIGA_RETURN),
+ * };
+ *
+ * and then in builtin_macros[]: { 0, HID_KEY_F12, sizeof(macro_dir) / sizeof(macro_dir[0]), macro_dir },
+ *
+ * keys the amiga doesn't have (f11, f12, print screen, scroll lock, pause) make the best triggers.
+ */
+static const amiga_macro_t builtin_macros[] = {
+    { 0, 0, 0, NULL }   // end of list
+};
+
+// runtime macros; their steps are packed into the pool in the same order as the macros
+static amiga_macro_t macros[MACRO_MAX];
+static uint16_t macro_count = 0;
+static uint16_t pool[MACRO_POOL_STEPS];
+static uint16_t pool_used = 0;
+
+// playback
+static const uint16_t *play_steps = NULL;
+static uint16_t play_length = 0,
+                play_pos = 0;
+static bool play_waiting = false;
+static uint64_t play_resume = 0;
+static uint8_t play_held[0x80 / 8];    // amiga keys the playing macro has pressed and not yet released
+
+// flash page being assembled by amiga_macro_save()
+static uint8_t flash_page[FLASH_PAGE_SIZE];
+static uint16_t flash_page_fill = 0;
+static uint32_t flash_page_offset = 0;
+
+/**
+ * Wait for the keyboard line to get through what's queued, with nothing else running meanwhile: until there's room
+ * for some codes, or until everything queued has been sent and handshaken. held in reset, the line is never idle, so
+ * not for ever.
+ *
+ * @param room      Free queue slots wanted, or 0 to wait for the line to be idle
+ * @return true     Got there
+ * @return false    Gave up after MACRO_WAIT_US
+ */
+static bool _macro_wait(uint8_t room)
+{
+    uint64_t start = time_us_64();
+
+    while (room ? (amiga_queue_free() < room) : !amiga_queue_idle()) {
+        if ((time_us_64() - start) >= MACRO_WAIT_US)
+            return false;
+        tight_loop_contents();
+    }
+
+    return true;
+}
+
+/**
+ * Stop the playing macro, if there is one, releasing any key it has down; cut short, it would leave the amiga
+ * seeing that key held
+ */
+static void _macro_stop(void)
+{
+    uint8_t held = 0;
+
+    if (play_steps == NULL)
+        return;
+    play_steps = NULL;
+
+    for (uint8_t code = 0; code < 0x80; code++)
+        held += (play_held[code / 8] >> (code % 8)) & 1;
+
+    // the releases go behind whatever the macro already queued, which may have filled it
+    _macro_wait(held);
+    for (uint8_t code = 0; held && (code < 0x80); code++) {
+        if (play_held[code / 8] & (1 << (code % 8)))
+            amiga_send(code, true);
+    }
+    memset(play_held, 0, sizeof(play_held));
+}
+
+/**
+ * Fold left and right modifiers together, so either ctrl (etc.) will do
+ *
+ * @param modifier  HID modifier bits
+ * @return uint8_t  Modifiers in the low nibble
+ */
+static inline uint8_t _macro_fold(uint8_t modifier)
+{
+    return (modifier | (modifier >> 4)) & 0x0f;
+}
+
+/**
+ * Find a runtime macro by its trigger
+ *
+ * @param modifier  Modifiers, folded
+ * @param keycode   HID keycode
+ * @return int      Index into macros[], or -1
+ */
+static int _macro_find(uint8_t modifier, uint8_t keycode)
+{
+    for (uint16_t i = 0; i < macro_count; i++)
+        if ((_macro_fold(macros[i].modifier) == modifier) && (macros[i].keycode == keycode))
+            return i;
+
+    return -1;
+}
+
+/**
+ * Remove a runtime macro, closing up the gap it leaves in the pool
+ *
+ * @param index     Index into macros[]
+ */
+static void _macro_remove(uint16_t index)
+{
+    uint16_t first = macros[index].steps - pool,
+             length = macros[index].length;
+
+    memmove(&pool[first], &pool[first + length], (pool_used - first - length) * sizeof(uint16_t));
+    pool_used -= length;
+
+    for (uint16_t i = index + 1; i < macro_count; i++) {
+        macros[i - 1] = macros[i];
+        macros[i - 1].steps -= length;
+    }
+    macro_count--;
+}
+
+/**
+ * Append bytes to flash, a page at a time
+ *
+ * @param data      Bytes to write
+ * @param length    Number of bytes
+ */
+static void _macro_flash_put(const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+
+    while (length--) {
+        flash_page[flash_page_fill++] = *bytes++;
+
+        if (flash_page_fill == FLASH_PAGE_SIZE) {
+            flash_range_program(flash_page_offset, flash_page, FLASH_PAGE_SIZE);
+            flash_page_offset += FLASH_PAGE_SIZE;
+            flash_page_fill = 0;
+        }
+    }
+}
+
+void amiga_macro_init(void)
+{
+    const uint8_t *flash = (const uint8_t *)(XIP_BASE + MACRO_FLASH_OFFSET);
+    const macro_flash_header_t *header = (const macro_flash_header_t *)flash;
+    const macro_flash_record_t *records = (const macro_flash_record_t *)(flash + sizeof(macro_flash_header_t));
+    const uint16_t *steps = (const uint16_t *)(records + header->count);
+    uint32_t total = 0;
+
+    macro_count = 0;
+    pool_used = 0;
+
+    // an erased sector (or one written by something else) is simply no macros
+    if ((header->magic != MACRO_FLASH_MAGIC) || (header->count > MACRO_MAX) || (header->steps > MACRO_POOL_STEPS))
+        return;
+
+    for (uint16_t i = 0; i < header->count; i++)
+        total += records[i].length;
+    if (total != header->steps)
+        return;
+
+    memcpy(pool, steps, header->steps * sizeof(uint16_t));
+    pool_used = header->steps;
+
+    for (uint16_t i = 0, first = 0; i < header->count; i++) {
+        macros[i].modifier = records[i].modifier;
+        macros[i].keycode = records[i].keycode;
+        macros[i].length = records[i].length;
+        macros[i].steps = &pool[first];
+        first += records[i].length;
+    }
+    macro_count = header->count;
+}
+
+bool amiga_macro_trigger(uint8_t modifier, uint8_t keycode)
+{
+    const amiga_macro_t *macro = NULL;
+    int index;
+
+    // one at a time; a second trigger whilst one plays is just a key
+    if (play_steps != NULL)
+        return false;
+
+    modifier = _macro_fold(modifier);
+
+    for (const amiga_macro_t *builtin = builtin_macros; builtin->steps != NULL; builtin++) {
+        if ((_macro_fold(builtin->modifier) == modifier) && (builtin->keycode == keycode)) {
+            macro = builtin;
+            break;
+        }
+    }
+
+    if ((macro == NULL) && ((index = _macro_find(modifier, keycode)) >= 0))
+        macro = &macros[index];
+
+    if ((macro == NULL) || !macro->length)
+        return false;
+
+    play_steps = macro->steps;
+    play_length = macro->length;
+    play_pos = 0;
+    play_waiting = false;
+    memset(play_held, 0, sizeof(play_held));
+
+    return true;
+}
+
+void amiga_macro_service(void)
+{
+    uint16_t step;
+    uint8_t code;
+
+    while (play_steps != NULL) {
+        if (play_pos == play_length) {
+            play_steps = NULL;
+            return;
+        }
+
+        step = play_steps[play_pos];
+
+        if (MACRO_IS_DELAY(step)) {
+            if (!play_waiting) {
+                // the pause starts once the amiga has everything before it
+                if (!amiga_queue_idle())
+                    return;
+                play_waiting = true;
+                play_resume = time_us_64() + ((uint64_t)(step & 0x7fff) * 1000);
+            }
+
+            if (time_us_64() < play_resume)
+                return;
+
+            play_waiting = false;
+            play_pos++;
+            continue;
+        }
+
+        if (!amiga_queue_free())
+            return;
+
+        code = step & 0x7f;
+        if (step & 0x80)
+            play_held[code / 8] &= ~(1 << (code % 8));
+        else
+            play_held[code / 8] |= 1 << (code % 8);
+
+        amiga_send(code, step & 0x80);
+        play_pos++;
+    }
+}
+
+bool amiga_macro_playing(void)
+{
+    return play_steps != NULL;
+}
+
+bool amiga_macro_define(uint8_t modifier, uint8_t keycode, const uint16_t *steps, uint16_t length)
+{
+    int index;
+
+    // the pool is about to move underneath whatever is playing
+    _macro_stop();
+
+    if ((index = _macro_find(_macro_fold(modifier), keycode)) >= 0)
+        _macro_remove(index);
+
+    if ((macro_count == MACRO_MAX) || (length > (MACRO_POOL_STEPS - pool_used)))
+        return false;
+
+    memcpy(&pool[pool_used], steps, length * sizeof(uint16_t));
+    macros[macro_count].modifier = modifier;
+    macros[macro_count].keycode = keycode;
+    macros[macro_count].length = length;
+    macros[macro_count].steps = &pool[pool_used];
+    macro_count++;
+    pool_used += length;
+
+    return true;
+}
+
+void amiga_macro_clear(void)
+{
+    _macro_stop();
+    macro_count = 0;
+    pool_used = 0;
+}
+
+bool amiga_macro_save(void)
+{
+    macro_flash_header_t header = { MACRO_FLASH_MAGIC, macro_count, pool_used };
+    macro_flash_record_t record;
+    uint32_t irq_status;
+
+    // with interrupts off, a code on the wire would stop part way and the amiga's handshake would go unseen; the
+    // amiga loses sync either way. so the line has to be idle first, as it does before a macro's pause
+    if (!_macro_wait(0))
+        return false;
+
+    // nothing may run from flash whilst it's being written: park the other core, then stop interrupts here
+    multicore_lockout_start_blocking();
+    irq_status = save_and_disable_interrupts();
+
+    flash_range_erase(MACRO_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+
+    flash_page_offset = MACRO_FLASH_OFFSET;
+    flash_page_fill = 0;
+
+    _macro_flash_put(&header, sizeof(header));
+    for (uint16_t i = 0; i < macro_count; i++) {
+        record.modifier = macros[i].modifier;
+        record.keycode = macros[i].keycode;
+        record.length = macros[i].length;
+        _macro_flash_put(&record, sizeof(record));
+    }
+    _macro_flash_put(pool, pool_used * sizeof(uint16_t));
+
+    // pad out the last page; erased flash reads as 0xff
+    if (flash_page_fill) {
+        memset(&flash_page[flash_page_fill], 0xff, FLASH_PAGE_SIZE - flash_page_fill);
+        flash_range_program(flash_page_offset, flash_page, FLASH_PAGE_SIZE);
+    }
+
+    restore_interrupts(irq_status);
+    multicore_lockout_end_blocking();
+
+    return true;
+}
@@ -0,0 +1,90 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * keyboard macros: a key (plus modifiers) on the usb keyboard plays a stored sequence of amiga keycodes.
+ */
+
+#ifndef _PLATFORM_AMIGA_MACRO_H
+#define _PLATFORM_AMIGA_MACRO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// macro steps: an amiga keycode (bit 7 set for key up), or a pause
+#define MACRO_DOWN(code)    ((uint16_t)(code))
+#define MACRO_UP(code)      ((uint16_t)((code) | 0x80))
+#define MACRO_DELAY(ms)     ((uint16_t)(0x8000 | ((ms) & 0x7fff)))
+#define MACRO_IS_DELAY(step) ((step) & 0x8000)
+
+// room for macros defined at runtime (and saved to flash)
+#define MACRO_MAX           16
+#define MACRO_POOL_STEPS    1536
+
+typedef struct {
+    uint8_t modifier;       // hid modifier bits which must be held; left and right are treated alike
+    uint8_t keycode;        // hid keycode which triggers the macro
+    uint16_t length;        // number of steps
+    const uint16_t *steps;
+} amiga_macro_t;
+
+/**
+ * @brief Load the macros saved in flash, if there are any
+ */
+void amiga_macro_init(void);
+
+/**
+ * @brief Start the macro bound to a key, if there is one. Built-in macros are looked at before runtime ones.
+ *
+ * @param modifier  Modifiers held
+ * @param keycode   HID keycode newly pressed
+ * @return true     A macro was started; the key shouldn't go to the Amiga
+ * @return false    No macro on this key (or one is already playing)
+ */
+bool amiga_macro_trigger(uint8_t modifier, uint8_t keycode);
+
+/**
+ * @brief Feed the playing macro into the keyboard queue as room allows; call regularly from the main loop
+ */
+void amiga_macro_service(void);
+
+/**
+ * @brief Check if a macro is playing
+ *
+ * @return true     Playing
+ * @return false    Not playing
+ */
+bool amiga_macro_playing(void);
+
+/**
+ * @brief Define (or redefine) a runtime macro; it lasts until power off unless saved. A macro still playing is
+ *        stopped, and any key it has down released.
+ *
+ * @param modifier  Modifiers to be held
+ * @param keycode   Trigger HID keycode
+ * @param steps     Steps, copied
+ * @param length    Number of steps
+ * @return true     Defined
+ * @return false    No room
+ */
+bool amiga_macro_define(uint8_t modifier, uint8_t keycode, const uint16_t *steps, uint16_t length);
+
+/**
+ * @brief Forget every runtime macro (built-in ones are unaffected), stopping one that's playing as
+ *        amiga_macro_define() does
+ */
+void amiga_macro_clear(void);
+
+/**
+ * @brief Write the runtime macros to flash, to be loaded at the next power-up. Waits for the keyboard line to be
+ *        idle, then stalls everything, including the other core, for the tens of milliseconds the flash erase takes.
+ *
+ * @return true     Saved
+ * @return false    The keyboard line didn't go idle (the Amiga is held in reset, say); nothing was written
+ */
+bool amiga_macro_save(void);
+
+#endif // _PLATFORM_AMIGA_MACRO_H
@@ -0,0 +1,75 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * mouse wheel, as newmouse rawkeys.
+ *
+ * newmouse (and the drivers which copy it) take a press and release of rawkey 0x7a/0x7b as a notch up/down and
+ * 0x7c/0x7d as a notch left/right. each code takes the keyboard line a couple of milliseconds, so notches are
+ * counted up here rather than queued, and one goes only when the line is idle: a key typed whilst the wheel spins is
+ * never stuck behind a run of wheel codes, and a fast spin comes out as no more than AMIGA_WHEEL_MAX_NOTCHES.
+ */
+
+#include "mouse_wheel.h"
+#include "keyboard.h"
+#include "keyboard_serial_io.h"
+#include "macro.h"
+
+#include <stdint.h>
+
+// notches not yet sent; [0] is vertical (positive up), [1] is horizontal (positive right)
+static int8_t notches[2] = { 0, 0 };
+
+/**
+ * Add to an axis's held back notches, within the limit
+ *
+ * @param axis      0 for vertical, 1 for horizontal
+ * @param delta     Notches
+ */
+static void _wheel_add(uint8_t axis, int8_t delta)
+{
+    int16_t total = notches[axis] + delta;
+
+    if (total > AMIGA_WHEEL_MAX_NOTCHES)
+        total = AMIGA_WHEEL_MAX_NOTCHES;
+    else if (total < -AMIGA_WHEEL_MAX_NOTCHES)
+        total = -AMIGA_WHEEL_MAX_NOTCHES;
+
+    notches[axis] = total;
+}
+
+void amiga_wheel_motion(int8_t wheel, int8_t pan)
+{
+    _wheel_add(0, wheel);
+    _wheel_add(1, pan);
+}
+
+void amiga_wheel_service(void)
+{
+    static const uint8_t codes[2][2] = {
+        { AMIGA_WHEELDN, AMIGA_WHEELUP },
+        { AMIGA_WHEELLT, AMIGA_WHEELRT },
+    };
+    static uint8_t next = 0;
+    uint8_t axis, code;
+
+    if (!notches[0] && !notches[1])
+        return;
+
+    // keys and macros first; they'd only be held up by a wheel code on the line
+    if (!amiga_queue_idle() || amiga_macro_playing())
+        return;
+
+    // the axes take turns, so a held tilt doesn't starve the wheel
+    axis = (notches[next] || !notches[!next]) ? next : !next;
+    next = !axis;
+
+    code = codes[axis][notches[axis] > 0];
+    notches[axis] += (notches[axis] > 0) ? -1 : 1;
+
+    amiga_send(code, false);
+    amiga_send(code, true);
+}
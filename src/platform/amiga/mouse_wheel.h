@@ -0,0 +1,34 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * mouse wheel, as newmouse rawkeys on the keyboard line.
+ */
+
+#ifndef _PLATFORM_AMIGA_MOUSE_WHEEL_H
+#define _PLATFORM_AMIGA_MOUSE_WHEEL_H
+
+#include <stdint.h>
+
+// the most notches held back per axis; a wheel spun faster than the keyboard line can carry loses the rest
+#ifndef AMIGA_WHEEL_MAX_NOTCHES
+#  define AMIGA_WHEEL_MAX_NOTCHES 8
+#endif
+
+/**
+ * @brief Add wheel motion, to go to the Amiga when the keyboard line is free
+ *
+ * @param wheel     Vertical notches, positive away from the user
+ * @param pan       Horizontal notches, positive to the right
+ */
+void amiga_wheel_motion(int8_t wheel, int8_t pan);
+
+/**
+ * @brief Send a held back notch if the keyboard line has nothing else to do; call regularly from the main loop
+ */
+void amiga_wheel_service(void);
+
+#endif // _PLATFORM_AMIGA_MOUSE_WHEEL_H
@@ -0,0 +1,112 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * amiga platform backend: keyboard serial line, macros and the quadrature mouse.
+ */
+
+#include "platform/platform.h"
+#include "keyboard_serial_io.h"
+#include "macro.h"
+#include "joystick.h"
+#include "mouse_wheel.h"
+#include "quad_mouse.h"
+
+#include "class/hid/hid.h"
+
+void platform_init()
+{
+    // the power-up handshake runs in the background from here
+    amiga_init();
+
+    // the mouse runs on core1
+    amiga_quad_mouse_init();
+}
+
+void platform_service()
+{
+    amiga_service();
+}
+
+const platform_keymap_t *platform_keymap_find(const char *name)
+{
+    return amiga_keymap_find(name);
+}
+
+void platform_key(const platform_keymap_t *map, uint8_t hidcode, bool up)
+{
+    amiga_hid_send(map, hidcode, up);
+}
+
+void platform_modifier(const platform_keymap_t *map, uint8_t modifier, bool up)
+{
+    amiga_hid_modifier(map, modifier, up);
+}
+
+void platform_key_flush()
+{
+    amiga_hid_flush();
+}
+
+uint32_t platform_key_batch()
+{
+    return amiga_hid_batch();
+}
+
+void platform_key_raw(uint8_t code, bool up)
+{
+    amiga_send(code, up);
+}
+
+uint8_t platform_key_room()
+{
+    return amiga_queue_free();
+}
+
+bool platform_macro_trigger(uint8_t modifier, uint8_t keycode)
+{
+    return amiga_macro_trigger(modifier, keycode);
+}
+
+uint8_t platform_leds()
+{
+    return amiga_caps_lock() ? KEYBOARD_LED_CAPSLOCK : 0;
+}
+
+void platform_reset(bool asserted)
+{
+    if (asserted)
+        amiga_assert_reset();
+    else
+        amiga_release_reset();
+}
+
+void platform_mouse_button(uint8_t port, enum platform_mouse_buttons button, bool pressed)
+{
+    static const enum amiga_quad_mouse_buttons buttons[] = {
+        [PLATFORM_MOUSE_LEFT] = AQM_LEFT,
+        [PLATFORM_MOUSE_MIDDLE] = AQM_MIDDLE,
+        [PLATFORM_MOUSE_RIGHT] = AQM_RIGHT,
+    };
+
+    amiga_quad_mouse_button(port, buttons[button], pressed);
+}
+
+void platform_mouse_motion(uint8_t port, int8_t x, int8_t y, uint32_t interval_us)
+{
+    amiga_quad_mouse_set_motion(port, x, y, interval_us);
+}
+
+void platform_mouse_wheel(int8_t wheel, int8_t pan)
+{
+    // newmouse rawkeys, on the keyboard line whichever port the mouse is on
+    amiga_wheel_motion(wheel, pan);
+}
+
+void platform_joystick(uint8_t port, uint8_t state)
+{
+    amiga_joystick_set(port, state);
+}
@@ -6,6 +6,14 @@
  * please find the complete license text at https://spdx.org/licenses/EPL-2.0
  *
  * amiga quadrature mouse interface.
+ *
+ * each controller port is a channel of its own: its own motion from core0, its own backlog, pacing and frame budget
+ * per axis. core1 runs every channel from one loop which never waits on any of them, so a port
+ * playing out a long backlog doesn't hold up a count due on the other.
+ *
+ * button changes go through the same channel, in order with the motion around them: each waits for the motion
+ * reported before it to play out, and motion reported after it waits for the button, so a click lands where the
+ * pointer was when it was made, and a drag starts there. AQM_BUTTON_WAIT_US bounds how long a button can be held up.
  */
 
 #include "config.h"
@@ -17,13 +25,73 @@
 
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
+#include "pico/sync.h"
 #include "hardware/gpio.h"
 
-// mouse motion values, used between core0 and core1
-volatile int8_t x = 0, y = 0;
-volatile bool motion_flag = false;
 volatile uint8_t motion_divider = 2;
 
+// output side of an axis
+typedef struct
+{
+    uint main_pin, quad_pin;    // h and hq, or v and vq
+    uint8_t state;              // position in the gray code sequence; the lines idle high, which is state 1
+    int32_t carry;              // motion short of a whole count once the divider has had its share
+    int32_t remaining;          // counts still to emit, signed
+    uint32_t period;            // us between counts, to spread them across the report interval
+    uint64_t last;              // when the last count went out
+    uint32_t sent[AQM_FRAME_COUNTS];    // when each of the last AQM_FRAME_COUNTS counts went out, oldest at sent_pos
+    uint8_t sent_pos;
+} aqm_axis_t;
+
+// a button change, and the motion reported before it
+typedef struct
+{
+    int32_t delta[2];           // in hid units
+    uint32_t interval;          // the reporting device's interval, us
+    uint32_t at;                // when the button changed
+    uint8_t button;             // enum amiga_quad_mouse_buttons
+    bool pressed;
+} aqm_button_event_t;
+
+typedef struct
+{
+    // motion and button changes from core0 not yet picked up by core1; guarded by lock
+    critical_section_t lock;
+    int32_t pending[2];         // motion since the last button change, in hid units
+    uint32_t interval;          // the reporting device's interval, us
+    aqm_button_event_t events[AQM_BUTTON_QUEUE];
+    uint8_t event_head, event_count;
+    uint8_t wanted;             // buttons core0 last asked for, a bit per enum amiga_quad_mouse_buttons
+    bool resync;                // a change didn't fit in events; once they're done, set the buttons to wanted
+    volatile bool fresh;        // read outside the lock, to keep core1 off it whilst there's nothing new
+
+    // core1's alone
+    aqm_axis_t axes[2];
+    aqm_button_event_t held;    // button change waiting on the motion ahead of it
+    bool holding;
+
+    uint button_pins[3];        // indexed by enum amiga_quad_mouse_buttons
+
+    // statistics; written by core1, read by core0
+    volatile amiga_quad_mouse_stats_t stats;
+} aqm_port_t;
+
+#define AQM_PORT(h, hq, v, vq, left, middle, right) \
+    { \
+        .axes = { \
+            { .main_pin = (h), .quad_pin = (hq), .state = 1, .period = AQM_EDGE_MIN_US }, \
+            { .main_pin = (v), .quad_pin = (vq), .state = 1, .period = AQM_EDGE_MIN_US }, \
+        }, \
+        .button_pins = { [AQM_LEFT] = (left), [AQM_MIDDLE] = (middle), [AQM_RIGHT] = (right) }, \
+    }
+
+static aqm_port_t ports[AQM_PORTS] = {
+    AQM_PORT(QM1_AMIGA_H, QM1_AMIGA_HQ, QM1_AMIGA_V, QM1_AMIGA_VQ, QM1_AMIGA_B1, QM1_AMIGA_B3, QM1_AMIGA_B2),
+#ifdef HAS_PORT2
+    AQM_PORT(QM2_AMIGA_H, QM2_AMIGA_HQ, QM2_AMIGA_V, QM2_AMIGA_VQ, QM2_AMIGA_B1, QM2_AMIGA_B3, QM2_AMIGA_B2),
+#endif
+};
+
 enum _mouse_pin_state { LOW, HIGH };
 
 static inline void _aqm_gpio_set(uint gpio, enum _mouse_pin_state state)
@@ -38,39 +106,206 @@ static inline void _aqm_gpio_set(uint gpio, enum _mouse_pin_state state)
     gpio_set_dir(gpio, GPIO_IN);
 }
 
+/**
+ * Take a pin for a port, released (high)
+ *
+ * @param gpio      Pin
+ */
+static void _aqm_gpio_init(uint gpio)
+{
+    gpio_init(gpio);
+    gpio_set_function(gpio, GPIO_FUNC_SIO);
+
+    // pins are active low, so when they are at 0 they're triggering; set high (off)
+    _aqm_gpio_set(gpio, HIGH);
+}
+
+/**
+ * Find a port's channel; a port the board doesn't have is port 1
+ *
+ * @param port          0 for port 1, 1 for port 2
+ * @return aqm_port_t*  Channel
+ */
+static inline aqm_port_t *_aqm_port(uint8_t port)
+{
+    return &ports[(port < AQM_PORTS) ? port : 0];
+}
+
+/**
+ * Pick up motion from core0, and work out how to spread each axis's backlog across the interval until the next
+ * report is due. motion up to the next button change is taken, and the button change is held until that has played
+ * out; nothing after it is taken until then.
+ *
+ * @param p         Channel
+ * @param now       Time now
+ */
+static void _aqm_take(aqm_port_t *p, uint64_t now)
+{
+    int32_t delta[2], units, counts, backlog;
+    uint32_t interval;
+    uint8_t axis, wanted = 0, button;
+    bool resync = false;
+
+    if (p->holding || !p->fresh)
+        return;
+
+    critical_section_enter_blocking(&p->lock);
+    if (p->event_count) {
+        p->held = p->events[p->event_head];
+        p->holding = true;
+        p->event_head = (p->event_head + 1) % AQM_BUTTON_QUEUE;
+        p->event_count--;
+
+        delta[0] = p->held.delta[0];
+        delta[1] = p->held.delta[1];
+        interval = p->held.interval;
+    } else {
+        delta[0] = p->pending[0];
+        delta[1] = p->pending[1];
+        interval = p->interval;
+        p->pending[0] = p->pending[1] = 0;
+
+        resync = p->resync;
+        wanted = p->wanted;
+        p->resync = false;
+    }
+    p->fresh = p->event_count || p->pending[0] || p->pending[1];
+    critical_section_exit(&p->lock);
+
+    // changes were dropped, so the pins may not match what core0 last asked for; put them right
+    if (resync) {
+        for (button = AQM_LEFT; button <= AQM_RIGHT; button++)
+            _aqm_gpio_set(p->button_pins[button], (wanted & (1 << button)) ? LOW : HIGH);
+    }
+
+    for (axis = 0; axis < 2; axis++) {
+        aqm_axis_t *out = &p->axes[axis];
+
+        units = delta[axis] + out->carry;
+        counts = units / motion_divider;
+        out->carry = units % motion_divider;
+        p->stats.requested[axis] += (counts < 0) ? -counts : counts;
+
+        out->remaining += counts;
+
+        // at the most the frame budget allows, a backlog this long takes AQM_BACKLOG_US to play out; beyond that the
+        // pointer would trail the hand, so what doesn't fit is dropped
+        backlog = (AQM_BACKLOG_US / AQM_FRAME_US) * AQM_FRAME_COUNTS;
+        if (out->remaining > backlog) {
+            p->stats.lost[axis] += out->remaining - backlog;
+            out->remaining = backlog;
+        } else if (out->remaining < -backlog) {
+            p->stats.lost[axis] += -backlog - out->remaining;
+            out->remaining = -backlog;
+        }
+
+        if (!out->remaining)
+            continue;
+
+        // evenly over the interval, so the last count goes just before the next report arrives; an axis which has
+        // been idle sends its first count straight away
+        out->period = interval / ((out->remaining < 0) ? -out->remaining : out->remaining);
+        if (out->period < AQM_EDGE_MIN_US)
+            out->period = AQM_EDGE_MIN_US;
+        if ((now - out->last) > out->period)
+            out->last = now - out->period;
+    }
+}
+
+/**
+ * Check an axis has budget for another count: the count AQM_FRAME_COUNTS back must be a whole frame ago, so that no
+ * frame, however it lines up, sees more than the budget
+ *
+ * @param out       Axis
+ * @param now       Time now
+ * @return true     A count may go now
+ * @return false    It has to wait for the frame to move on
+ */
+static inline bool _aqm_budget(aqm_axis_t *out, uint64_t now)
+{
+    return ((uint32_t)now - out->sent[out->sent_pos]) >= AQM_FRAME_US;
+}
+
+/**
+ * Move an axis one count: change one line of its pair, per the gray code
+ *
+ * @param p         Channel
+ * @param axis      0 for horizontal, 1 for vertical
+ * @param direction -1 or 1
+ * @param now       Time now
+ */
+static void _aqm_step(aqm_port_t *p, uint8_t axis, int8_t direction, uint64_t now)
+{
+    aqm_axis_t *out = &p->axes[axis];
+
+    out->state = (out->state + direction) & 3;
+
+    // (main, quad) = (1,0), (1,1), (0,1), (0,0) for states 0 to 3. which line changes depends on the way it's
+    // going, so both are set to the new state's levels; the one which doesn't change is left as it was
+    _aqm_gpio_set(out->main_pin, (out->state < 2) ? HIGH : LOW);
+    _aqm_gpio_set(out->quad_pin, ((out->state == 1) || (out->state == 2)) ? HIGH : LOW);
+
+    p->stats.sent[axis]++;
+    out->remaining -= direction;
+    out->last = now;
+
+    out->sent[out->sent_pos] = now;
+    out->sent_pos = (out->sent_pos + 1) % AQM_FRAME_COUNTS;
+}
+
+/**
+ * Run a channel's counts which are due
+ *
+ * @param p         Channel
+ * @param now       Time now
+ */
+static void _aqm_service(aqm_port_t *p, uint64_t now)
+{
+    uint8_t axis;
+    aqm_axis_t *out;
+
+    _aqm_take(p, now);
+
+    // a button change goes once the motion ahead of it is out, or once it's waited as long as it may
+    if (p->holding && ((!p->axes[0].remaining && !p->axes[1].remaining)
+        || (((uint32_t)now - p->held.at) >= AQM_BUTTON_WAIT_US))) {
+        _aqm_gpio_set(p->button_pins[p->held.button], p->held.pressed ? LOW : HIGH);
+        p->holding = false;
+    }
+
+    if (!p->axes[0].remaining && !p->axes[1].remaining)
+        return;
+
+    // each axis keeps its own pace, so a diagonal comes out as a line rather than a staircase. a count over the
+    // frame budget stays in remaining, and goes as soon as the oldest count in the frame drops out of it
+    for (axis = 0; axis < 2; axis++) {
+        out = &p->axes[axis];
+        if (out->remaining && ((now - out->last) >= out->period) && _aqm_budget(out, now))
+            _aqm_step(p, axis, (out->remaining < 0) ? -1 : 1, now);
+    }
+}
+
 void amiga_quad_mouse_init()
 {
+    uint8_t port, i;
+
     // obtain the pins we want to use
-    gpio_init(QM1_AMIGA_H);
-    gpio_init(QM1_AMIGA_V);
-    gpio_init(QM1_AMIGA_HQ);
-    gpio_init(QM1_AMIGA_VQ);
-    gpio_init(QM1_AMIGA_B1);
-    gpio_init(QM1_AMIGA_B2);
-    gpio_init(QM1_AMIGA_B3);
-
-    gpio_set_function(QM1_AMIGA_H, GPIO_FUNC_SIO);
-    gpio_set_function(QM1_AMIGA_V, GPIO_FUNC_SIO);
-    gpio_set_function(QM1_AMIGA_HQ, GPIO_FUNC_SIO);
-    gpio_set_function(QM1_AMIGA_VQ, GPIO_FUNC_SIO);
-    gpio_set_function(QM1_AMIGA_B1, GPIO_FUNC_SIO);
-    gpio_set_function(QM1_AMIGA_B2, GPIO_FUNC_SIO);
-    gpio_set_function(QM1_AMIGA_B3, GPIO_FUNC_SIO);
-
-    // pins are active low, so when they are at 0 they're triggering; set all high (off)
-    _aqm_gpio_set(QM1_AMIGA_H, HIGH);
-    _aqm_gpio_set(QM1_AMIGA_V, HIGH);
-    _aqm_gpio_set(QM1_AMIGA_HQ, HIGH);
-    _aqm_gpio_set(QM1_AMIGA_VQ, HIGH);
-    _aqm_gpio_set(QM1_AMIGA_B1, HIGH);
-    _aqm_gpio_set(QM1_AMIGA_B2, HIGH);
-    _aqm_gpio_set(QM1_AMIGA_B3, HIGH);
+    for (port = 0; port < AQM_PORTS; port++) {
+        for (i = 0; i < 2; i++) {
+            _aqm_gpio_init(ports[port].axes[i].main_pin);
+            _aqm_gpio_init(ports[port].axes[i].quad_pin);
+        }
+        for (i = 0; i < 3; i++)
+            _aqm_gpio_init(ports[port].button_pins[i]);
+
+        critical_section_init(&ports[port].lock);
+    }
 
     // start the mouse motion loop on core1
     multicore_launch_core1(amiga_quad_mouse_motion);
 }
 
-void amiga_quad_mouse_button(enum amiga_quad_mouse_buttons button, bool pressed)
+void amiga_quad_mouse_button(uint8_t port, enum amiga_quad_mouse_buttons button, bool pressed)
 {
     // ahprintf("[aqm] button %s state %s\n",
     //     (button == AQM_LEFT) ? "left" :
@@ -79,29 +314,63 @@ void amiga_quad_mouse_button(enum amiga_quad_mouse_buttons button, bool pressed)
     //     pressed ? "down" : "up"
     // );
 
-    switch (button) {
-        case AQM_LEFT:      _aqm_gpio_set(QM1_AMIGA_B1, pressed ? LOW : HIGH); break;
-        case AQM_MIDDLE:    _aqm_gpio_set(QM1_AMIGA_B3, pressed ? LOW : HIGH); break;
-        case AQM_RIGHT:     _aqm_gpio_set(QM1_AMIGA_B2, pressed ? LOW : HIGH); break;
-        // default:            ahprintf("[aqm] unhandled button press!\n");
+    aqm_port_t *p = _aqm_port(port);
+    aqm_button_event_t *event;
+
+    if (button > AQM_RIGHT)
+        return;
+
+    // the motion so far goes with the change, to be played out before it
+    critical_section_enter_blocking(&p->lock);
+    if (pressed)
+        p->wanted |= 1 << button;
+    else
+        p->wanted &= ~(1 << button);
+
+    if (p->event_count < AQM_BUTTON_QUEUE) {
+        event = &p->events[(p->event_head + p->event_count) % AQM_BUTTON_QUEUE];
+        event->delta[0] = p->pending[0];
+        event->delta[1] = p->pending[1];
+        event->interval = p->interval;
+        event->at = time_us_32();
+        event->button = button;
+        event->pressed = pressed;
+        p->event_count++;
+        p->pending[0] = p->pending[1] = 0;
+    } else {
+        // more changes than anyone could click in AQM_BUTTON_WAIT_US; lose this one, but not where it left the button
+        p->resync = true;
     }
+    p->fresh = true;
+    critical_section_exit(&p->lock);
+}
+
+void amiga_quad_mouse_set_motion(uint8_t port, int8_t in_x, int8_t in_y, uint32_t interval_us)
+{
+    aqm_port_t *p = _aqm_port(port);
+
+    // added to whatever core1 hasn't picked up yet, so nothing is lost when reports come faster than it looks, or
+    // when several mice share the port. their motion is then due by the soonest of their next reports
+    critical_section_enter_blocking(&p->lock);
+    if ((!p->pending[0] && !p->pending[1]) || (interval_us < p->interval))
+        p->interval = interval_us;
+    p->pending[0] += in_x;
+    p->pending[1] += in_y;
+    p->fresh = true;
+    critical_section_exit(&p->lock);
 }
 
-void amiga_quad_mouse_set_motion(int8_t in_x, int8_t in_y)
+void amiga_quad_mouse_service()
 {
-    x = in_x;
-    y = in_y;
-    motion_flag = true;
+    uint64_t now = time_us_64();
 
-    // @todo use fifo write here to unblock core1 thread?
+    for (uint8_t port = 0; port < AQM_PORTS; port++)
+        _aqm_service(&ports[port], now);
 }
 
 void amiga_quad_mouse_motion()
 {
     // ahprintf("[aqm] hello from core1, mouse motion output loop starting\n");
-    int8_t out_x, out_y;
-    uint8_t quad_mx_state = 0, quad_my_state = 0;
-    bool motion_x_skip = false, motion_y_skip = false;
 
     /**
      * a little note about quadrature motion state.
@@ -115,72 +384,23 @@ void amiga_quad_mouse_motion()
      * https://amigadev.elowar.com/read/ADCD_2.1/Hardware_Manual_guide/node017F.html
      */
 
+    // let core0 park us whilst it writes to flash (saving keyboard macros)
+    multicore_lockout_victim_init();
+
     while (1) {
-        // @todo use blocking fifo read here to prevent wasting cycles?
-        out_x = x;
-        out_y = y;
-        x = y = 0;
-        motion_flag = false;
-
-        while (((out_x != 0) || (out_y != 0)) && !motion_flag) {
-            motion_x_skip = false;
-            motion_y_skip = false;
-
-            if ((out_x % motion_divider) != 0)
-                motion_x_skip = true;
-            if ((out_y % motion_divider) != 0)
-                motion_y_skip = true;
-
-            if ((out_x != 0) && !motion_x_skip) {
-                // handle x-axis motion
-                if (out_x < 0)
-                    quad_mx_state--;
-                else if (out_x > 0)
-                    quad_mx_state++;
-                // fix wraparound
-                if (quad_mx_state == 255)
-                    quad_mx_state = 3;
-                else if (quad_mx_state == 4)
-                    quad_mx_state = 0;
-
-                switch (quad_mx_state) {
-                    case 0: _aqm_gpio_set(QM1_AMIGA_H, HIGH); break;
-                    case 1: _aqm_gpio_set(QM1_AMIGA_HQ, HIGH); break;
-                    case 2: _aqm_gpio_set(QM1_AMIGA_H, LOW); break;
-                    case 3: _aqm_gpio_set(QM1_AMIGA_HQ, LOW); break;
-                }
-            }
-
-            if (out_x < 0) out_x++;
-            if (out_x > 0) out_x--;
-
-            if ((out_y != 0) && !motion_y_skip) {
-                // handle y-axis motion
-                if (out_y < 0)
-                    quad_my_state--;
-                else if (out_y > 0)
-                    quad_my_state++;
-                // fix wraparound
-                if (quad_my_state == 255)
-                    quad_my_state = 3;
-                else if (quad_my_state == 4)
-                    quad_my_state = 0;
-
-                switch (quad_my_state) {
-                    case 0: _aqm_gpio_set(QM1_AMIGA_V, HIGH); break;
-                    case 1: _aqm_gpio_set(QM1_AMIGA_VQ, HIGH); break;
-                    case 2: _aqm_gpio_set(QM1_AMIGA_V, LOW); break;
-                    case 3: _aqm_gpio_set(QM1_AMIGA_VQ, LOW); break;
-                }
-            }
-
-            if (out_y < 0) out_y++;
-            if (out_y > 0) out_y--;
-
-            //if (motion_x_skip && motion_y_skip)
-            //    continue;
-
-            sleep_us(300); // delay before next iteration to prevent missing state change
-        }
+        amiga_quad_mouse_service();
+        tight_loop_contents();
+    }
+}
+
+void amiga_quad_mouse_stats(uint8_t port, amiga_quad_mouse_stats_t *out)
+{
+    aqm_port_t *p = _aqm_port(port);
+    uint8_t axis;
+
+    for (axis = 0; axis < 2; axis++) {
+        out->requested[axis] = p->stats.requested[axis];
+        out->sent[axis] = p->stats.sent[axis];
+        out->lost[axis] = p->stats.lost[axis];
     }
 }
@@ -11,14 +11,88 @@
 #ifndef _PLATFORM_AMIGA_QUAD_MOUSE_H
 #define _PLATFORM_AMIGA_QUAD_MOUSE_H
 
+#include "config.h"
+
 #include <stdint.h>
 #include <stdbool.h>
 
 enum amiga_quad_mouse_buttons { AQM_LEFT, AQM_MIDDLE, AQM_RIGHT };
 
+// controller ports driven; each is a channel of its own, with its own pacing and budget
+#ifdef HAS_PORT2
+#  define AQM_PORTS 2
+#else
+#  define AQM_PORTS 1
+#endif
+
+// the amiga samples joy0dat/joy1dat once per video frame, and takes the difference from the last sample as signed
+// 8-bit; more counts than that between two samples and the pointer jumps backwards. no more than AQM_FRAME_COUNTS go
+// out in any AQM_FRAME_US, wherever the amiga's frames fall, and the rest wait for the next frame.
+#if AMIGA_VIDEO == AMIGA_VIDEO_NTSC
+#  define AQM_FRAME_US 16684
+#else
+#  define AQM_FRAME_US 20000
+#endif
+
+#ifndef AQM_FRAME_COUNTS
+#  define AQM_FRAME_COUNTS 127
+#endif
+
+// the shortest time between counts on an axis, however far behind the output is: the ceiling on the edge rate
+#ifndef AQM_EDGE_MIN_US
+#  define AQM_EDGE_MIN_US 150
+#endif
+
+// the longest a button change waits for the motion reported before it to play out, and how many changes can wait
+#ifndef AQM_BUTTON_WAIT_US
+#  define AQM_BUTTON_WAIT_US 40000
+#endif
+#define AQM_BUTTON_QUEUE 16
+
+// the longest backlog an axis may have, at the most the frame budget allows; motion beyond it is dropped (and
+// counted as lost)
+#define AQM_BACKLOG_US 100000
+
+/**
+ * motion accounting: what was asked for, what went out on the lines and what was dropped. all counts are amiga counter
+ * steps, [0] is horizontal, [1] is vertical. whether the amiga's counters see what went out is checked on a pc, by
+ * the trace harness's model of them (see test/trace/host/host_sdk.c), not here.
+ */
+typedef struct
+{
+    uint32_t requested[2];  // counts asked for via amiga_quad_mouse_set_motion() (after the motion divider)
+    uint32_t sent[2];       // counts stepped out on the lines
+    uint32_t lost[2];       // counts dropped because the backlog would have taken over AQM_BACKLOG_US to play out
+} amiga_quad_mouse_stats_t;
+
 void amiga_quad_mouse_init();
 void amiga_quad_mouse_motion();
-void amiga_quad_mouse_button(enum amiga_quad_mouse_buttons button, bool pressed);
-void amiga_quad_mouse_set_motion(int8_t in_x, int8_t in_y);
+
+/**
+ * @brief One pass of core1's loop: step out whatever counts and button changes are due on each port. the trace
+ *        harness calls it in place of core1
+ */
+void amiga_quad_mouse_service();
+
+/**
+ * @brief Queue a button change, to go out once the motion queued before it has
+ *
+ * @param port          0 for port 1, 1 for port 2; a port the board doesn't have is port 1
+ * @param button        Button
+ * @param pressed       true if pressed, false if released
+ */
+void amiga_quad_mouse_button(uint8_t port, enum amiga_quad_mouse_buttons button, bool pressed);
+
+/**
+ * @brief Queue mouse motion, to be spread across the interval until the device's next report
+ *
+ * @param port          0 for port 1, 1 for port 2; a port the board doesn't have is port 1
+ * @param in_x          Horizontal motion, positive to the right
+ * @param in_y          Vertical motion, positive downwards
+ * @param interval_us   The device's report interval; 0 to send as fast as AQM_EDGE_MIN_US allows
+ */
+void amiga_quad_mouse_set_motion(uint8_t port, int8_t in_x, int8_t in_y, uint32_t interval_us);
+
+void amiga_quad_mouse_stats(uint8_t port, amiga_quad_mouse_stats_t *out);
 
 #endif
@@ -0,0 +1,638 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * atari st ikbd emulation.
+ *
+ * the line to the st is 8n1 at 7812.5 baud, run by a pair of pio statemachines. everything for the st goes
+ * through one queue a whole packet at a time, so mouse and status packets are never split by a key. commands from
+ * the st are handled as the ikbd documentation describes, except for joysticks (there aren't any) and running code
+ * loaded into the 6301's ram (memory load and read work; execute is ignored).
+ */
+
+#include "config.h"
+#include "ikbd.h"
+#include "keyboard.h"
+#include "ikbd.pio.h" // generated at compile time
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+#define IKBD_BAUD           7812.5f
+#define IKBD_QUEUE_SIZE     64      // must be a power of two
+
+// packet headers
+#define IKBD_VERSION        0xf0    // reply to a reset; the original rom's
+#define IKBD_STATUS         0xf6    // status and memory read replies
+#define IKBD_ABS_MOUSE      0xf7
+#define IKBD_REL_MOUSE      0xf8    // | buttons: bit 1 left, bit 0 right
+#define IKBD_TIME           0xfc
+#define IKBD_JOY_REPORT     0xfd
+
+enum ikbd_mouse_mode { MOUSE_RELATIVE = 0x08, MOUSE_ABSOLUTE = 0x09, MOUSE_KEYCODE = 0x0a };
+enum ikbd_joy_mode { JOY_EVENT = 0x14, JOY_INTERROGATE = 0x15, JOY_KEYCODE = 0x19 };
+
+// mouse button action bits (command 0x07)
+#define BUTTON_ABS_ON_PRESS     0x01
+#define BUTTON_ABS_ON_RELEASE   0x02
+#define BUTTON_AS_KEYS          0x04
+
+static PIO ikbd_pio = pio0;
+static uint tx_sm,
+            rx_sm;
+
+static uint8_t queue[IKBD_QUEUE_SIZE];
+static uint8_t queue_head = 0,
+               queue_tail = 0;
+static bool paused = false;         // pause output (0x13), until the next command
+
+static bool caps_lock = false;
+
+static struct {
+    uint8_t mode;
+    bool enabled;
+    bool y_bottom;                  // y=0 at the bottom; motion up is positive
+    uint8_t button_action;
+    uint8_t threshold[2];           // relative: motion before a packet is sent
+    uint8_t scale[2];               // absolute: motion per unit of position
+    uint8_t keycode_delta[2];       // keycode: motion per cursor key
+    uint16_t max[2];                // absolute: largest position
+    int32_t position[2];
+    int32_t pending[2];             // motion not reported (or applied to the position) yet
+    uint8_t buttons,                // held now, as in a relative packet
+            reported_buttons;       // as of the last relative packet
+    uint8_t abs_events;             // button changes since the last absolute report
+} mouse;
+
+static struct {
+    uint8_t mode;
+    bool enabled;
+    uint8_t keycode_params[6];
+} joystick;
+
+// time-of-day clock: year (00-99), month, day, hour, minute, second as of tod_set_at
+static uint8_t tod[6] = { 0, 1, 1, 0, 0, 0 };
+static uint64_t tod_set_at = 0;
+
+// the 6301's ram, for memory load and read
+static uint8_t ram[128];
+
+// command being received; memory load data follows its parameters
+static uint8_t cmd[7];
+static uint8_t cmd_len = 0,
+               cmd_need = 0;
+static uint8_t load_addr = 0,
+               load_left = 0;
+
+/**
+ * Move whatever's queued into the transmitter, as far as it'll take
+ */
+static void _ikbd_feed()
+{
+    while (!paused && (queue_head != queue_tail) && !pio_sm_is_tx_fifo_full(ikbd_pio, tx_sm)) {
+        pio_sm_put(ikbd_pio, tx_sm, queue[queue_tail]);
+        queue_tail = (queue_tail + 1) & (IKBD_QUEUE_SIZE - 1);
+    }
+}
+
+/**
+ * Queue a packet for the st: all of it, or (if there isn't room) none of it
+ *
+ * @param bytes     Packet
+ * @param len       Length of packet
+ * @return true     Queued
+ * @return false    No room
+ */
+static bool _ikbd_put(const uint8_t *bytes, uint8_t len)
+{
+    if (ikbd_queue_free() < len)
+        return false;
+
+    for (uint8_t i = 0; i < len; i++) {
+        queue[queue_head] = bytes[i];
+        queue_head = (queue_head + 1) & (IKBD_QUEUE_SIZE - 1);
+    }
+
+    _ikbd_feed();
+    return true;
+}
+
+/**
+ * Put the ikbd back as it powers up
+ */
+static void _ikbd_defaults()
+{
+    mouse.mode = MOUSE_RELATIVE;
+    mouse.enabled = true;
+    mouse.y_bottom = false;
+    mouse.button_action = 0;
+    mouse.threshold[0] = mouse.threshold[1] = 1;
+    mouse.scale[0] = mouse.scale[1] = 1;
+    mouse.keycode_delta[0] = mouse.keycode_delta[1] = 1;
+    mouse.max[0] = mouse.max[1] = 0;
+    mouse.position[0] = mouse.position[1] = 0;
+    mouse.pending[0] = mouse.pending[1] = 0;
+    mouse.reported_buttons = mouse.buttons;
+    mouse.abs_events = 0;
+
+    joystick.mode = JOY_EVENT;
+    joystick.enabled = true;
+
+    paused = false;
+}
+
+/**
+ * Send the absolute mouse position (and button changes since the last time)
+ */
+static void _ikbd_abs_report()
+{
+    uint8_t packet[6] = {
+        IKBD_ABS_MOUSE, mouse.abs_events,
+        mouse.position[0] >> 8, mouse.position[0], mouse.position[1] >> 8, mouse.position[1]
+    };
+
+    if (_ikbd_put(packet, sizeof(packet)))
+        mouse.abs_events = 0;
+}
+
+/**
+ * Report (or apply) pending mouse motion as the st has asked for it
+ */
+static void _ikbd_mouse()
+{
+    uint8_t packet[3];
+    int32_t step;
+
+    if (!mouse.enabled) {
+        mouse.pending[0] = mouse.pending[1] = 0;
+        return;
+    }
+
+    switch (mouse.mode) {
+        case MOUSE_RELATIVE:
+            while ((abs(mouse.pending[0]) >= mouse.threshold[0]) || (abs(mouse.pending[1]) >= mouse.threshold[1])
+                || (mouse.buttons != mouse.reported_buttons)
+            ) {
+                packet[0] = IKBD_REL_MOUSE | mouse.buttons;
+                packet[1] = (mouse.pending[0] > 127) ? 127 : (mouse.pending[0] < -127) ? -127 : mouse.pending[0];
+                packet[2] = (mouse.pending[1] > 127) ? 127 : (mouse.pending[1] < -127) ? -127 : mouse.pending[1];
+                if (!_ikbd_put(packet, sizeof(packet)))
+                    return;
+
+                mouse.pending[0] -= (int8_t)packet[1];
+                mouse.pending[1] -= (int8_t)packet[2];
+                mouse.reported_buttons = mouse.buttons;
+            }
+            break;
+
+        case MOUSE_ABSOLUTE:
+            // nothing is sent until asked for; the position just moves, in whole units of the scale
+            for (uint8_t axis = 0; axis < 2; axis++) {
+                step = mouse.pending[axis] / mouse.scale[axis];
+                mouse.pending[axis] -= step * mouse.scale[axis];
+                mouse.position[axis] += step;
+                if (mouse.position[axis] < 0)
+                    mouse.position[axis] = 0;
+                if (mouse.position[axis] > mouse.max[axis])
+                    mouse.position[axis] = mouse.max[axis];
+            }
+            break;
+
+        case MOUSE_KEYCODE:
+            // cursor key make and break for every delta's worth of motion
+            for (uint8_t axis = 0; axis < 2; axis++) {
+                while (abs(mouse.pending[axis]) >= mouse.keycode_delta[axis]) {
+                    packet[0] = axis
+                        ? ((mouse.pending[1] < 0) ? ST_UP : ST_DOWN)
+                        : ((mouse.pending[0] < 0) ? ST_LEFT : ST_RIGHT);
+                    packet[1] = packet[0] | 0x80;
+                    if (!_ikbd_put(packet, 2))
+                        return;
+
+                    mouse.pending[axis] += (mouse.pending[axis] < 0) ? mouse.keycode_delta[axis] : -mouse.keycode_delta[axis];
+                }
+            }
+            break;
+    }
+}
+
+/**
+ * Decode a bcd byte from the st
+ *
+ * @param bcd       Byte as sent
+ * @param out       Where to put the binary value
+ * @return true     Valid; out has been written
+ * @return false    Not bcd; the field is to be left alone
+ */
+static bool _ikbd_from_bcd(uint8_t bcd, uint8_t *out)
+{
+    if (((bcd >> 4) > 9) || ((bcd & 0x0f) > 9))
+        return false;
+
+    *out = ((bcd >> 4) * 10) + (bcd & 0x0f);
+    return true;
+}
+
+/**
+ * Bring the time-of-day clock up to now
+ */
+static void _ikbd_tod_advance()
+{
+    static const uint8_t month_days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    uint64_t now = time_us_64();
+    uint32_t elapsed = (now - tod_set_at) / 1000000,
+             carry;
+    uint8_t days;
+
+    // only whole seconds are taken; the remainder stays in tod_set_at
+    tod_set_at += (uint64_t)elapsed * 1000000;
+
+    carry = tod[5] + elapsed;
+    tod[5] = carry % 60;
+    carry = tod[4] + (carry / 60);
+    tod[4] = carry % 60;
+    carry = tod[3] + (carry / 60);
+    tod[3] = carry % 24;
+    carry /= 24;
+
+    while (carry--) {
+        days = ((tod[1] >= 1) && (tod[1] <= 12)) ? month_days[tod[1] - 1] : 31;
+        if ((tod[1] == 2) && !(tod[0] % 4))
+            days++;
+
+        if (++tod[2] > days) {
+            tod[2] = 1;
+            if (++tod[1] > 12) {
+                tod[1] = 1;
+                tod[0] = (tod[0] + 1) % 100;
+            }
+        }
+    }
+}
+
+/**
+ * Answer a status inquiry: 0xf6 and the parameters the matching set command would take
+ *
+ * @param command   The set command being asked about (the inquiry without bit 7)
+ */
+static void _ikbd_status(uint8_t command)
+{
+    uint8_t reply[8] = { IKBD_STATUS };
+
+    switch (command) {
+        case 0x07:
+            reply[1] = 0x07;
+            reply[2] = mouse.button_action;
+            break;
+
+        case MOUSE_RELATIVE:
+        case MOUSE_ABSOLUTE:
+        case MOUSE_KEYCODE:
+            reply[1] = mouse.mode;
+            if (mouse.mode == MOUSE_ABSOLUTE) {
+                reply[2] = mouse.max[0] >> 8;
+                reply[3] = mouse.max[0];
+                reply[4] = mouse.max[1] >> 8;
+                reply[5] = mouse.max[1];
+            } else if (mouse.mode == MOUSE_KEYCODE) {
+                reply[2] = mouse.keycode_delta[0];
+                reply[3] = mouse.keycode_delta[1];
+            }
+            break;
+
+        case 0x0b:
+            reply[1] = 0x0b;
+            reply[2] = mouse.threshold[0];
+            reply[3] = mouse.threshold[1];
+            break;
+
+        case 0x0c:
+            reply[1] = 0x0c;
+            reply[2] = mouse.scale[0];
+            reply[3] = mouse.scale[1];
+            break;
+
+        case 0x0f:
+        case 0x10:
+            reply[1] = mouse.y_bottom ? 0x0f : 0x10;
+            break;
+
+        case 0x12:
+            reply[1] = mouse.enabled ? 0x00 : 0x12;
+            break;
+
+        case JOY_EVENT:
+        case JOY_INTERROGATE:
+        case JOY_KEYCODE:
+            reply[1] = joystick.mode;
+            if (joystick.mode == JOY_KEYCODE)
+                for (uint8_t i = 0; i < 6; i++)
+                    reply[2 + i] = joystick.keycode_params[i];
+            break;
+
+        case 0x1a:
+            reply[1] = joystick.enabled ? 0x00 : 0x1a;
+            break;
+
+        default:
+            // nothing to say about anything else
+            return;
+    }
+
+    _ikbd_put(reply, sizeof(reply));
+}
+
+/**
+ * Number of parameter bytes which follow a command
+ *
+ * @param command   Command byte
+ * @return int8_t   Parameters, or -1 for a byte which isn't a command (and is ignored)
+ */
+static int8_t _ikbd_params(uint8_t command)
+{
+    switch (command) {
+        case 0x08: case 0x0d: case 0x0f: case 0x10: case 0x11: case 0x12: case 0x13:
+        case 0x14: case 0x15: case 0x16: case 0x18: case 0x1a: case 0x1c:
+            return 0;
+        case 0x07: case 0x17: case 0x80:
+            return 1;
+        case 0x0a: case 0x0b: case 0x0c: case 0x21: case 0x22:
+            return 2;
+        case 0x20:
+            return 3;   // then as many data bytes as the third says
+        case 0x09:
+            return 4;
+        case 0x0e:
+            return 5;
+        case 0x19: case 0x1b:
+            return 6;
+    }
+
+    // status inquiries
+    if ((command >= 0x87) && (command <= 0x9a))
+        return 0;
+
+    return -1;
+}
+
+/**
+ * Act on a complete command in cmd[]
+ */
+static void _ikbd_command()
+{
+    uint8_t reply[8];
+
+    // any command other than pause lets output go again
+    paused = (cmd[0] == 0x13);
+
+    switch (cmd[0]) {
+        case 0x80:
+            // reset: only 0x80 0x01 is one
+            if (cmd[1] != 0x01)
+                break;
+            queue_tail = queue_head;
+            _ikbd_defaults();
+            reply[0] = IKBD_VERSION;
+            _ikbd_put(reply, 1);
+            break;
+
+        case 0x07:
+            mouse.button_action = cmd[1];
+            break;
+
+        case MOUSE_RELATIVE:
+            mouse.mode = MOUSE_RELATIVE;
+            mouse.enabled = true;
+            mouse.reported_buttons = mouse.buttons;
+            break;
+
+        case MOUSE_ABSOLUTE:
+            mouse.mode = MOUSE_ABSOLUTE;
+            mouse.enabled = true;
+            mouse.max[0] = (cmd[1] << 8) | cmd[2];
+            mouse.max[1] = (cmd[3] << 8) | cmd[4];
+            break;
+
+        case MOUSE_KEYCODE:
+            mouse.mode = MOUSE_KEYCODE;
+            mouse.enabled = true;
+            mouse.keycode_delta[0] = cmd[1] ? cmd[1] : 1;
+            mouse.keycode_delta[1] = cmd[2] ? cmd[2] : 1;
+            break;
+
+        case 0x0b:
+            mouse.threshold[0] = cmd[1] ? cmd[1] : 1;
+            mouse.threshold[1] = cmd[2] ? cmd[2] : 1;
+            break;
+
+        case 0x0c:
+            mouse.scale[0] = cmd[1] ? cmd[1] : 1;
+            mouse.scale[1] = cmd[2] ? cmd[2] : 1;
+            break;
+
+        case 0x0d:
+            _ikbd_abs_report();
+            break;
+
+        case 0x0e:
+            // cmd[1] is filler
+            mouse.position[0] = (cmd[2] << 8) | cmd[3];
+            mouse.position[1] = (cmd[4] << 8) | cmd[5];
+            break;
+
+        case 0x0f:
+            mouse.y_bottom = true;
+            break;
+
+        case 0x10:
+            mouse.y_bottom = false;
+            break;
+
+        case 0x12:
+            mouse.enabled = false;
+            break;
+
+        case JOY_EVENT:
+        case JOY_INTERROGATE:
+            joystick.mode = cmd[0];
+            joystick.enabled = true;
+            break;
+
+        case 0x16:
+            // no joysticks; both are always centred with fire up
+            reply[0] = IKBD_JOY_REPORT;
+            reply[1] = reply[2] = 0;
+            _ikbd_put(reply, 3);
+            break;
+
+        case JOY_KEYCODE:
+            joystick.mode = JOY_KEYCODE;
+            joystick.enabled = true;
+            for (uint8_t i = 0; i < 6; i++)
+                joystick.keycode_params[i] = cmd[1 + i];
+            break;
+
+        case 0x1a:
+            joystick.enabled = false;
+            break;
+
+        case 0x1b:
+            // fields which aren't bcd are left as they are
+            _ikbd_tod_advance();
+            for (uint8_t i = 0; i < 6; i++)
+                _ikbd_from_bcd(cmd[1 + i], &tod[i]);
+            break;
+
+        case 0x1c:
+            _ikbd_tod_advance();
+            reply[0] = IKBD_TIME;
+            for (uint8_t i = 0; i < 6; i++)
+                reply[1 + i] = ((tod[i] / 10) << 4) | (tod[i] % 10);
+            _ikbd_put(reply, 7);
+            break;
+
+        case 0x20:
+            load_addr = cmd[2];
+            load_left = cmd[3];
+            break;
+
+        case 0x21:
+            reply[0] = IKBD_STATUS;
+            reply[1] = 0x20;
+            for (uint8_t i = 0; i < 6; i++)
+                reply[2 + i] = ram[(cmd[2] + i) & 0x7f];
+            _ikbd_put(reply, 8);
+            break;
+
+        case 0x11:  // resume; done above
+        case 0x13:  // pause; likewise
+        case 0x17:  // joystick monitoring, fire button monitoring and controller execute: there's no joystick, and
+        case 0x18:  // no 6301 to run code on
+        case 0x22:
+            break;
+
+        default:
+            if (cmd[0] & 0x80)
+                _ikbd_status(cmd[0] & 0x7f);
+            break;
+    }
+
+    _ikbd_feed();
+}
+
+/**
+ * Take a byte from the st
+ *
+ * @param byte      Byte received
+ */
+static void _ikbd_receive(uint8_t byte)
+{
+    int8_t params;
+
+    if (load_left) {
+        // the 6301's ram sits at 0x80-0xff
+        ram[load_addr++ & 0x7f] = byte;
+        load_left--;
+        return;
+    }
+
+    if (!cmd_len) {
+        if ((params = _ikbd_params(byte)) < 0)
+            return;
+        cmd_need = params;
+    }
+
+    cmd[cmd_len++] = byte;
+    if (cmd_len > cmd_need) {
+        cmd_len = 0;
+        _ikbd_command();
+    }
+}
+
+void ikbd_init()
+{
+    _ikbd_defaults();
+
+    tx_sm = pio_claim_unused_sm(ikbd_pio, true);
+    ikbd_tx_program_init(ikbd_pio, tx_sm, pio_add_program(ikbd_pio, &ikbd_tx_program), IKBD_ST_TX, IKBD_BAUD);
+
+    rx_sm = pio_claim_unused_sm(ikbd_pio, true);
+    ikbd_rx_program_init(ikbd_pio, rx_sm, pio_add_program(ikbd_pio, &ikbd_rx_program), IKBD_ST_RX, IKBD_BAUD);
+}
+
+void ikbd_service()
+{
+    while (!pio_sm_is_rx_fifo_empty(ikbd_pio, rx_sm))
+        _ikbd_receive(pio_sm_get(ikbd_pio, rx_sm) >> 24);
+
+    _ikbd_mouse();
+    _ikbd_feed();
+}
+
+void ikbd_key(uint8_t code, bool up)
+{
+    uint8_t byte = code | (up ? 0x80 : 0x00);
+
+    // tos flips caps lock on each make; follow it, for the usb keyboard's light
+    if ((code == ST_CAPSLOCK) && !up)
+        caps_lock = !caps_lock;
+
+    _ikbd_put(&byte, 1);
+}
+
+uint8_t ikbd_queue_free()
+{
+    // one slot is always left empty to tell a full queue from an empty one
+    return (IKBD_QUEUE_SIZE - 1) - ((queue_head - queue_tail) & (IKBD_QUEUE_SIZE - 1));
+}
+
+bool ikbd_caps_lock()
+{
+    return caps_lock;
+}
+
+void ikbd_mouse_button(bool right, bool pressed)
+{
+    uint8_t bit = right ? 0x01 : 0x02,
+            held = pressed ? (mouse.buttons | bit) : (mouse.buttons & ~bit);
+
+    if (held == mouse.buttons)
+        return;
+    mouse.buttons = held;
+
+    // for the next absolute report: right down, right up, left down, left up
+    mouse.abs_events |= right ? (pressed ? 0x01 : 0x02) : (pressed ? 0x04 : 0x08);
+
+    if ((mouse.button_action & BUTTON_AS_KEYS) || (mouse.mode == MOUSE_KEYCODE)) {
+        // buttons are keys instead, and relative packets carry them as up
+        mouse.reported_buttons = mouse.buttons = 0;
+        ikbd_key(right ? ST_MOUSE_RIGHT : ST_MOUSE_LEFT, !pressed);
+        return;
+    }
+
+    if ((mouse.mode == MOUSE_ABSOLUTE)
+        && (mouse.button_action & (pressed ? BUTTON_ABS_ON_PRESS : BUTTON_ABS_ON_RELEASE))
+    ) {
+        _ikbd_mouse();
+        _ikbd_abs_report();
+        return;
+    }
+
+    _ikbd_mouse();
+}
+
+void ikbd_mouse_motion(int8_t x, int8_t y)
+{
+    // the st's y runs downwards unless it's asked otherwise; cursor keys in keycode mode follow the hand regardless
+    mouse.pending[0] += x;
+    mouse.pending[1] += (mouse.y_bottom && (mouse.mode != MOUSE_KEYCODE)) ? -y : y;
+
+    _ikbd_mouse();
+}
@@ -0,0 +1,66 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * atari st intelligent keyboard (ikbd) emulation: keys and mouse out, commands in, over the st's keyboard acia.
+ */
+
+#ifndef _PLATFORM_ATARI_ST_IKBD_H
+#define _PLATFORM_ATARI_ST_IKBD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Start the serial line to the st, in the state the ikbd powers up in
+ */
+void ikbd_init();
+
+/**
+ * @brief Act on commands from the st and send what's waiting for it; call regularly from the main loop
+ */
+void ikbd_service();
+
+/**
+ * @brief Send a key to the st
+ *
+ * @param code      St scancode
+ * @param up        true if key release (break), false if press (make)
+ */
+void ikbd_key(uint8_t code, bool up);
+
+/**
+ * @brief Number of bytes which can be queued for the st before the queue overflows
+ *
+ * @return uint8_t  Free queue slots
+ */
+uint8_t ikbd_queue_free();
+
+/**
+ * @brief Get the caps lock state, as tos will have it (it toggles on every caps lock make)
+ *
+ * @return true     Caps lock is on
+ * @return false    Caps lock is off
+ */
+bool ikbd_caps_lock();
+
+/**
+ * @brief Pass on a mouse button; the st mouse has two
+ *
+ * @param right     true for the right button, false for the left
+ * @param pressed   true if pressed, false if released
+ */
+void ikbd_mouse_button(bool right, bool pressed);
+
+/**
+ * @brief Pass on mouse motion; it's reported however the st has asked for it
+ *
+ * @param x         Horizontal motion, positive to the right
+ * @param y         Vertical motion, positive downwards
+ */
+void ikbd_mouse_motion(int8_t x, int8_t y);
+
+#endif // _PLATFORM_ATARI_ST_IKBD_H
@@ -0,0 +1,36 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * atari st keyboard: scancodes and the hid to st layout.
+ */
+
+#ifndef _PLATFORM_ATARI_ST_KEYBOARD_H
+#define _PLATFORM_ATARI_ST_KEYBOARD_H
+
+#include <stdint.h>
+
+// scancodes the backend itself needs; the rest only appear in keymap.c. bit 7 set is the key's break code.
+#define ST_UNKNOWN      0xff
+#define ST_CAPSLOCK     0x3a
+#define ST_UP           0x48
+#define ST_LEFT         0x4b
+#define ST_RIGHT        0x4d
+#define ST_DOWN         0x50
+#define ST_MOUSE_LEFT   0x74    // mouse buttons, when the st asks for them as keys
+#define ST_MOUSE_RIGHT  0x75
+
+// the st's platform_keymap_t (see platform/platform.h); the same shape as the amiga's
+typedef struct platform_keymap {
+    const char *name;
+    const uint8_t *keys;        // [256] indexed by hid keycode; ST_UNKNOWN for keys the st doesn't have
+    const uint8_t *modifiers;   // [8] indexed by bit number in the boot protocol modifier byte
+} st_keymap_t;
+
+// the one layout; st scancodes, like hid keycodes, say where a key is, and tos applies the national layout
+extern const st_keymap_t st_keymap;
+
+#endif // _PLATFORM_ATARI_ST_KEYBOARD_H
@@ -0,0 +1,65 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * hid to atari st scancodes. in ram, as the amiga's are, so the lookup never waits on flash.
+ *
+ * the st has undo and help where a pc has page up and page down, and keypad ( and ) where it has num lock and
+ * scroll lock; it has no f11, f12 or gui keys.
+ */
+
+#include <stdint.h>
+
+#include "pico.h"
+
+#include "keyboard.h"
+
+static const uint8_t __not_in_flash("keymap_st") st_keys[256] = {
+    [0 ... 255] = ST_UNKNOWN,
+
+    [0x04] = 0x1e, [0x05] = 0x30, [0x06] = 0x2e, [0x07] = 0x20,     // a b c d
+    [0x08] = 0x12, [0x09] = 0x21, [0x0a] = 0x22, [0x0b] = 0x23,     // e f g h
+    [0x0c] = 0x17, [0x0d] = 0x24, [0x0e] = 0x25, [0x0f] = 0x26,     // i j k l
+    [0x10] = 0x32, [0x11] = 0x31, [0x12] = 0x18, [0x13] = 0x19,     // m n o p
+    [0x14] = 0x10, [0x15] = 0x13, [0x16] = 0x1f, [0x17] = 0x14,     // q r s t
+    [0x18] = 0x16, [0x19] = 0x2f, [0x1a] = 0x11, [0x1b] = 0x2d,     // u v w x
+    [0x1c] = 0x15, [0x1d] = 0x2c,                                   // y z
+
+    [0x1e] = 0x02, [0x1f] = 0x03, [0x20] = 0x04, [0x21] = 0x05,     // 1 2 3 4
+    [0x22] = 0x06, [0x23] = 0x07, [0x24] = 0x08, [0x25] = 0x09,     // 5 6 7 8
+    [0x26] = 0x0a, [0x27] = 0x0b,                                   // 9 0
+
+    [0x28] = 0x1c, [0x29] = 0x01, [0x2a] = 0x0e, [0x2b] = 0x0f,     // return escape backspace tab
+    [0x2c] = 0x39, [0x2d] = 0x0c, [0x2e] = 0x0d, [0x2f] = 0x1a,     // space - = [
+    [0x30] = 0x1b, [0x31] = 0x2b, [0x32] = 0x2b, [0x33] = 0x27,     // ] \ iso # ;
+    [0x34] = 0x28, [0x35] = 0x29, [0x36] = 0x33, [0x37] = 0x34,     // ' ` , .
+    [0x38] = 0x35, [0x39] = ST_CAPSLOCK,                            // / caps lock
+
+    [0x3a] = 0x3b, [0x3b] = 0x3c, [0x3c] = 0x3d, [0x3d] = 0x3e,     // f1 - f4
+    [0x3e] = 0x3f, [0x3f] = 0x40, [0x40] = 0x41, [0x41] = 0x42,     // f5 - f8
+    [0x42] = 0x43, [0x43] = 0x44,                                   // f9 f10
+
+    [0x47] = 0x64,                                                  // scroll lock: keypad )
+    [0x49] = 0x52, [0x4a] = 0x47, [0x4b] = 0x62, [0x4c] = 0x53,     // insert home(clr) page up(help) delete
+    [0x4e] = 0x61,                                                  // page down(undo)
+    [0x4f] = ST_RIGHT, [0x50] = ST_LEFT, [0x51] = ST_DOWN, [0x52] = ST_UP,
+
+    [0x53] = 0x63,                                                  // num lock: keypad (
+    [0x54] = 0x65, [0x55] = 0x66, [0x56] = 0x4a, [0x57] = 0x4e,     // keypad / * - +
+    [0x58] = 0x72,                                                  // keypad enter
+    [0x59] = 0x6d, [0x5a] = 0x6e, [0x5b] = 0x6f, [0x5c] = 0x6a,     // keypad 1 - 4
+    [0x5d] = 0x6b, [0x5e] = 0x6c, [0x5f] = 0x67, [0x60] = 0x68,     // keypad 5 - 8
+    [0x61] = 0x69, [0x62] = 0x70, [0x63] = 0x71,                    // keypad 9 0 .
+    [0x64] = 0x60,                                                  // iso \ (the key left of z)
+};
+
+// one ctrl, one alt; the st has no gui keys
+static const uint8_t __not_in_flash("keymap_st") st_modifiers[8] = {
+    0x1d, 0x2a, 0x38, ST_UNKNOWN,   // left ctrl, shift, alt, gui
+    0x1d, 0x36, 0x38, ST_UNKNOWN,   // right ctrl, shift, alt, gui
+};
+
+const st_keymap_t __not_in_flash("keymap") st_keymap = { "st", st_keys, st_modifiers };
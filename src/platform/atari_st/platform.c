@@ -0,0 +1,111 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * atari st platform backend: everything goes through the ikbd line. the st's scancodes are positional, so there's
+ * one layout; tos does the rest.
+ */
+
+#include "platform/platform.h"
+#include "ikbd.h"
+#include "keyboard.h"
+
+#include <string.h>
+
+#include "class/hid/hid.h"
+
+void platform_init()
+{
+    ikbd_init();
+}
+
+void platform_service()
+{
+    ikbd_service();
+}
+
+const platform_keymap_t *platform_keymap_find(const char *name)
+{
+    return strcmp(name, st_keymap.name) ? NULL : &st_keymap;
+}
+
+void platform_key(const platform_keymap_t *map, uint8_t hidcode, bool up)
+{
+    uint8_t code = (map ? map : &st_keymap)->keys[hidcode];
+
+    if (code != ST_UNKNOWN)
+        ikbd_key(code, up);
+}
+
+void platform_modifier(const platform_keymap_t *map, uint8_t modifier, bool up)
+{
+    uint8_t code;
+
+    if (!modifier)
+        return;
+
+    code = (map ? map : &st_keymap)->modifiers[__builtin_ctz(modifier)];
+    if (code != ST_UNKNOWN)
+        ikbd_key(code, up);
+}
+
+void platform_key_flush()
+{
+    // keys go straight into the ikbd queue in the order they arrive; nothing is held back
+}
+
+uint32_t platform_key_batch()
+{
+    return 1;
+}
+
+void platform_key_raw(uint8_t code, bool up)
+{
+    ikbd_key(code, up);
+}
+
+uint8_t platform_key_room()
+{
+    return ikbd_queue_free();
+}
+
+bool platform_macro_trigger(uint8_t modifier, uint8_t keycode)
+{
+    return false;
+}
+
+uint8_t platform_leds()
+{
+    return ikbd_caps_lock() ? KEYBOARD_LED_CAPSLOCK : 0;
+}
+
+void platform_reset(bool asserted)
+{
+    // the ikbd has no line to reset the st with
+}
+
+void platform_mouse_button(uint8_t port, enum platform_mouse_buttons button, bool pressed)
+{
+    // the ikbd has the one mouse, whichever port it's assigned to, and it has no middle button
+    if (button != PLATFORM_MOUSE_MIDDLE)
+        ikbd_mouse_button(button == PLATFORM_MOUSE_RIGHT, pressed);
+}
+
+void platform_mouse_motion(uint8_t port, int8_t x, int8_t y, uint32_t interval_us)
+{
+    // the st reads whole packets, so there's nothing to pace
+    ikbd_mouse_motion(x, y);
+}
+
+void platform_mouse_wheel(int8_t wheel, int8_t pan)
+{
+    // the ikbd has no way to report a wheel
+}
+
+void platform_joystick(uint8_t port, uint8_t state)
+{
+    // joysticks plug into the st's own ikbd ports
+}
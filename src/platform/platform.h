@@ -0,0 +1,156 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * platform backend interface: what the usb front end hands its key, modifier and mouse events to, and where it gets
+ * its led state from. exactly one backend is built in, picked by PLATFORM_TYPE in CMakeLists.txt; each one
+ * implements every function here (see platform/<name>/platform.c).
+ */
+
+#ifndef _PLATFORM_PLATFORM_H
+#define _PLATFORM_PLATFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// a keyboard layout; defined by each backend
+typedef struct platform_keymap platform_keymap_t;
+
+enum platform_mouse_buttons { PLATFORM_MOUSE_LEFT, PLATFORM_MOUSE_MIDDLE, PLATFORM_MOUSE_RIGHT };
+
+// digital joystick lines, for platform_joystick()
+#define PLATFORM_JOY_UP     0x01
+#define PLATFORM_JOY_DOWN   0x02
+#define PLATFORM_JOY_LEFT   0x04
+#define PLATFORM_JOY_RIGHT  0x08
+#define PLATFORM_JOY_FIRE1  0x10
+#define PLATFORM_JOY_FIRE2  0x20
+#define PLATFORM_JOY_FIRE3  0x40
+
+/**
+ * @brief Start the backend's outputs; must not wait on the machine at the other end
+ */
+void platform_init();
+
+/**
+ * @brief Regular jobs; call on every pass of the main loop
+ */
+void platform_service();
+
+/**
+ * @brief Find a keyboard layout by name
+ *
+ * @param name                      Layout name
+ * @return const platform_keymap_t* The layout, or NULL if there's no such layout
+ */
+const platform_keymap_t *platform_keymap_find(const char *name);
+
+/**
+ * @brief Pass on a key, translating it with a layout
+ *
+ * @param map       Layout, or NULL for the default
+ * @param hidcode   HID keycode
+ * @param up        true if key release, false if press
+ */
+void platform_key(const platform_keymap_t *map, uint8_t hidcode, bool up);
+
+/**
+ * @brief Pass on a modifier, translating it with a layout
+ *
+ * @param map       Layout, or NULL for the default
+ * @param modifier  One HID modifier bit
+ * @param up        true if key release, false if press
+ */
+void platform_modifier(const platform_keymap_t *map, uint8_t modifier, bool up);
+
+/**
+ * @brief Send any keys and modifiers the backend is holding back to order them
+ */
+void platform_key_flush();
+
+/**
+ * @brief Identify the batch of keys being held back; changes with every flush (see amiga_hid_batch())
+ *
+ * @return uint32_t Batch serial number
+ */
+uint32_t platform_key_batch();
+
+/**
+ * @brief Pass on a code in the machine's own keycode set, untranslated
+ *
+ * @param code      Keycode
+ * @param up        true if key release, false if press
+ */
+void platform_key_raw(uint8_t code, bool up);
+
+/**
+ * @brief Number of codes which can be sent before the output queue overflows
+ *
+ * @return uint8_t  Free queue slots
+ */
+uint8_t platform_key_room();
+
+/**
+ * @brief Start the keyboard macro bound to a key, if the backend has one
+ *
+ * @param modifier  HID modifiers held
+ * @param keycode   HID keycode newly pressed
+ * @return true     A macro was started; the key goes no further
+ * @return false    No macro
+ */
+bool platform_macro_trigger(uint8_t modifier, uint8_t keycode);
+
+/**
+ * @brief Keyboard leds as the machine has them
+ *
+ * @return uint8_t  HID led bits (KEYBOARD_LED_CAPSLOCK, ...)
+ */
+uint8_t platform_leds();
+
+/**
+ * @brief Hold the machine in reset (ctrl-amiga-amiga and the like), or let it go; ignored where the keyboard
+ *        can't reset the machine
+ *
+ * @param asserted  true to reset, false to release
+ */
+void platform_reset(bool asserted);
+
+/**
+ * @brief Pass on a mouse button
+ *
+ * @param port      Controller port the mouse is assigned to, 0 for the first; a backend with one mouse ignores it
+ * @param button    Button
+ * @param pressed   true if pressed, false if released
+ */
+void platform_mouse_button(uint8_t port, enum platform_mouse_buttons button, bool pressed);
+
+/**
+ * @brief Pass on mouse motion
+ *
+ * @param port          Controller port the mouse is assigned to, 0 for the first; a backend with one mouse ignores it
+ * @param x             Horizontal motion, positive to the right
+ * @param y             Vertical motion, positive downwards
+ * @param interval_us   How often the mouse reports, as measured; a backend may pace its output to it
+ */
+void platform_mouse_motion(uint8_t port, int8_t x, int8_t y, uint32_t interval_us);
+
+/**
+ * @brief Pass on mouse wheel motion
+ *
+ * @param wheel     Vertical notches, positive away from the user
+ * @param pan       Horizontal notches (tilt), positive to the right
+ */
+void platform_mouse_wheel(int8_t wheel, int8_t pan);
+
+/**
+ * @brief Set the lines of a digital joystick; called from the usb report path, so must be quick
+ *
+ * @param port      Controller port the joystick is assigned to, 0 for the first
+ * @param state     PLATFORM_JOY_* bits which are held
+ */
+void platform_joystick(uint8_t port, uint8_t state);
+
+#endif // _PLATFORM_PLATFORM_H
@@ -0,0 +1,542 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * ps/2 keyboard and mouse host.
+ *
+ * each port has a pio statemachine which clocks bytes in and out at the device's pace; the fifo interrupt checks
+ * each frame and queues its byte. the main loop turns the bytes into boot protocol reports and hands them to
+ * usb_hid.c as virtual devices, so ps/2 keys and motion go through exactly the path usb ones do: layouts, macros,
+ * the reset chord and canonical ordering included. there's no enumeration and no polling interval; a key is in a
+ * report within a pass of the main loop of its last bit.
+ *
+ * the keyboard is read in scan code set 2, which every keyboard powers up in. the mouse is a plain three byte
+ * stream mode mouse.
+ */
+
+#ifdef PS2_HOST
+
+#include "config.h"
+#include "ps2_host.h"
+#include "usb_hid.h"
+#include "platform/platform.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+
+#include "class/hid/hid.h"
+
+#include "ps2_host.pio.h" // generated at compile time
+
+#define PS2_RX_SIZE         16      // bytes per port waiting for the main loop; must be a power of two
+#define PS2_CMD_SIZE        8       // command bytes per port waiting to go
+#define PS2_ACK_US          25000   // a command not acknowledged in this long is given up on, with the rest queued
+#define PS2_PACKET_US       25000   // the bytes of one mouse packet come well within this of each other
+
+// device to host
+#define PS2_ACK             0xfa
+#define PS2_RESEND          0xfe
+#define PS2_BAT_OK          0xaa    // self test passed: just powered up, reset, or plugged in
+
+// host to device
+#define PS2_CMD_LEDS        0xed
+#define PS2_CMD_ENABLE      0xf4    // mouse: start streaming packets
+#define PS2_CMD_RESET       0xff
+
+// set 2 prefixes
+#define PS2_KBD_EXTENDED    0xe0
+#define PS2_KBD_BREAK       0xf0
+#define PS2_KBD_PAUSE       0xe1    // e1 14 77 e1 f0 14 f0 77, on press only
+
+// hid usages
+#define PS2_HID_PAUSE       0x48
+#define PS2_HID_MODIFIERS   0xe0    // left ctrl; modifiers are usages 0xe0-0xe7, in modifier bit order
+
+#define PS2_KBD_PORT        0
+#define PS2_MOUSE_PORT      1
+
+typedef struct {
+    uint dat_pin;                       // clock is the pin after
+    uint sm;
+    void (*receive)(uint8_t byte);      // what the device sends, other than replies to commands
+    volatile uint8_t rx[PS2_RX_SIZE];
+    volatile uint8_t rx_head;           // written by the interrupt
+    uint8_t rx_tail;
+    volatile bool resync;               // a frame arrived broken
+    uint8_t cmd[PS2_CMD_SIZE];          // cmd[0] is on its way if awaiting_ack
+    uint8_t cmd_count;
+    bool awaiting_ack;
+    uint64_t sent_at;
+    uint64_t received_at;               // when ps2_service() took the last byte
+} ps2_port_t;
+
+static void _ps2_kbd_receive(uint8_t byte);
+#ifdef HAS_PS2_MOUSE
+static void _ps2_mouse_receive(uint8_t byte);
+#endif
+
+static PIO ps2_pio = pio1;
+static uint ps2_offset;
+
+static ps2_port_t ports[] = {
+    [PS2_KBD_PORT] = { .dat_pin = PS2_KBD_DAT, .receive = _ps2_kbd_receive },
+#ifdef HAS_PS2_MOUSE
+    [PS2_MOUSE_PORT] = { .dat_pin = PS2_MOUSE_DAT, .receive = _ps2_mouse_receive },
+#endif
+};
+
+#define PS2_PORTS (sizeof(ports) / sizeof(ports[0]))
+
+static struct {
+    bool extended;                      // e0 seen
+    bool release;                       // f0 seen
+    uint8_t pause_skip;                 // bytes of the pause sequence still to come
+    hid_keyboard_report_t report;       // as last handed to usb_hid.c
+    uint8_t leds;                       // ps/2 led bits last sent, 0xff to send them again
+} kbd;
+
+#ifdef HAS_PS2_MOUSE
+static struct {
+    bool streaming;                     // enabled since its last self test
+    bool bat;                           // self test passed; its id byte is next
+    uint8_t packet[3];
+    uint8_t fill;
+} mouse;
+#endif
+
+/**
+ * Set 2 scan codes to hid usages, without and with the e0 prefix. 0 for codes which aren't keys (or are keys usb
+ * doesn't have); e0 12 and e0 59 are the fake shifts some keys wrap themselves in, and are dropped. in ram, as the
+ * keymaps are.
+ */
+static const uint8_t __not_in_flash("ps2") set2_keys[0x84] = {
+    [0x01] = 0x42, [0x03] = 0x3e, [0x04] = 0x3c, [0x05] = 0x3a,     // f9 f5 f3 f1
+    [0x06] = 0x3b, [0x07] = 0x45, [0x09] = 0x43, [0x0a] = 0x41,     // f2 f12 f10 f8
+    [0x0b] = 0x3f, [0x0c] = 0x3d, [0x0d] = 0x2b, [0x0e] = 0x35,     // f6 f4 tab `
+    [0x11] = 0xe2, [0x12] = 0xe1, [0x13] = 0x88, [0x14] = 0xe0,     // lalt lshift katakana lctrl
+    [0x15] = 0x14, [0x16] = 0x1e, [0x1a] = 0x1d, [0x1b] = 0x16,     // q 1 z s
+    [0x1c] = 0x04, [0x1d] = 0x1a, [0x1e] = 0x1f, [0x21] = 0x06,     // a w 2 c
+    [0x22] = 0x1b, [0x23] = 0x07, [0x24] = 0x08, [0x25] = 0x21,     // x d e 4
+    [0x26] = 0x20, [0x29] = 0x2c, [0x2a] = 0x19, [0x2b] = 0x09,     // 3 space v f
+    [0x2c] = 0x17, [0x2d] = 0x15, [0x2e] = 0x22, [0x31] = 0x11,     // t r 5 n
+    [0x32] = 0x05, [0x33] = 0x0b, [0x34] = 0x0a, [0x35] = 0x1c,     // b h g y
+    [0x36] = 0x23, [0x3a] = 0x10, [0x3b] = 0x0d, [0x3c] = 0x18,     // 6 m j u
+    [0x3d] = 0x24, [0x3e] = 0x25, [0x41] = 0x36, [0x42] = 0x0e,     // 7 8 , k
+    [0x43] = 0x0c, [0x44] = 0x12, [0x45] = 0x27, [0x46] = 0x26,     // i o 0 9
+    [0x49] = 0x37, [0x4a] = 0x38, [0x4b] = 0x0f, [0x4c] = 0x33,     // . / l ;
+    [0x4d] = 0x13, [0x4e] = 0x2d, [0x51] = 0x87, [0x52] = 0x34,     // p - ro '
+    [0x54] = 0x2f, [0x55] = 0x2e, [0x58] = 0x39, [0x59] = 0xe5,     // [ = caps lock rshift
+    [0x5a] = 0x28, [0x5b] = 0x30, [0x5d] = 0x31, [0x61] = 0x64,     // return ] \ (# on iso) iso \ (by left shift)
+    [0x64] = 0x8a, [0x66] = 0x2a, [0x67] = 0x8b, [0x69] = 0x59,     // henkan backspace muhenkan kp1
+    [0x6a] = 0x89, [0x6b] = 0x5c, [0x6c] = 0x5f, [0x70] = 0x62,     // yen kp4 kp7 kp0
+    [0x71] = 0x63, [0x72] = 0x5a, [0x73] = 0x5d, [0x74] = 0x5e,     // kp. kp2 kp5 kp6
+    [0x75] = 0x60, [0x76] = 0x29, [0x77] = 0x53, [0x78] = 0x44,     // kp8 escape num lock f11
+    [0x79] = 0x57, [0x7a] = 0x5b, [0x7b] = 0x56, [0x7c] = 0x55,     // kp+ kp3 kp- kp*
+    [0x7d] = 0x61, [0x7e] = 0x47, [0x83] = 0x40,                    // kp9 scroll lock f7
+};
+
+static const uint8_t __not_in_flash("ps2") set2_extended_keys[0x80] = {
+    [0x11] = 0xe6, [0x14] = 0xe4, [0x1f] = 0xe3, [0x27] = 0xe7,     // ralt rctrl lgui rgui
+    [0x2f] = 0x65, [0x37] = 0x66, [0x4a] = 0x54, [0x5a] = 0x58,     // menu power kp/ kp enter
+    [0x69] = 0x4d, [0x6b] = 0x50, [0x6c] = 0x4a, [0x70] = 0x49,     // end left home insert
+    [0x71] = 0x4c, [0x72] = 0x51, [0x74] = 0x4f, [0x75] = 0x52,     // delete down right up
+    [0x7a] = 0x4e, [0x7c] = 0x46, [0x7d] = 0x4b,                    // page down print screen page up
+};
+
+/**
+ * Frame a byte for the statemachine: data, odd parity and stop, inverted as it drives pindirs
+ *
+ * @param byte      Byte to send
+ * @return uint32_t Word for the tx fifo
+ */
+static inline uint32_t _ps2_frame(uint8_t byte)
+{
+    uint32_t parity = !(__builtin_popcount(byte) & 1);
+
+    return ~(byte | (parity << 8) | (1u << 9)) & 0x3ff;
+}
+
+/**
+ * PIO interrupt: check each frame which has arrived and queue its byte for the main loop
+ */
+static void _ps2_irq()
+{
+    ps2_port_t *port;
+    uint32_t frame;
+    uint8_t byte, head;
+
+    for (uint8_t i = 0; i < PS2_PORTS; i++) {
+        port = &ports[i];
+
+        while (!pio_sm_is_rx_fifo_empty(ps2_pio, port->sm)) {
+            // data in bits 0-7, then parity, then stop
+            frame = pio_sm_get(ps2_pio, port->sm) >> 22;
+            byte = frame;
+
+            if (!(frame & 0x200) || !((__builtin_popcount(byte) + ((frame >> 8) & 1)) & 1)) {
+                port->resync = true;
+                continue;
+            }
+
+            head = (port->rx_head + 1) & (PS2_RX_SIZE - 1);
+            if (head == port->rx_tail)
+                continue;   // the main loop is a long way behind; there's nothing better to do with it
+
+            port->rx[port->rx_head] = byte;
+            port->rx_head = head;
+        }
+    }
+}
+
+/**
+ * Put a port's statemachine back at idle after a broken frame, and have the device send again
+ *
+ * @param port      Port
+ */
+static void _ps2_restart(ps2_port_t *port)
+{
+    pio_sm_set_enabled(ps2_pio, port->sm, false);
+    pio_sm_clear_fifos(ps2_pio, port->sm);
+    pio_sm_restart(ps2_pio, port->sm);
+    pio_sm_set_pindirs_with_mask(ps2_pio, port->sm, 0, 3u << port->dat_pin);
+    pio_sm_exec(ps2_pio, port->sm, pio_encode_jmp(ps2_offset));
+
+    // sending comes first, so the inhibit aborts whatever the device is part way through. the broken frame was most
+    // likely the reply to a command in flight, if there is one: send that again, otherwise ask for a resend
+    pio_sm_put(ps2_pio, port->sm, _ps2_frame(port->awaiting_ack ? port->cmd[0] : PS2_RESEND));
+    if (port->awaiting_ack)
+        port->sent_at = time_us_64();
+
+    port->resync = false;
+    pio_sm_set_enabled(ps2_pio, port->sm, true);
+}
+
+/**
+ * Queue command bytes for a device; each goes once the one before it has been acknowledged
+ *
+ * @param port      Port
+ * @param bytes     Command and its parameters
+ * @param len       Number of bytes
+ */
+static void _ps2_command(ps2_port_t *port, const uint8_t *bytes, uint8_t len)
+{
+    if ((port->cmd_count + len) > PS2_CMD_SIZE)
+        return;
+
+    memcpy(&port->cmd[port->cmd_count], bytes, len);
+    port->cmd_count += len;
+}
+
+/**
+ * Send the next command byte, if there is one and the device isn't still answering the last
+ *
+ * @param port      Port
+ */
+static void _ps2_command_next(ps2_port_t *port)
+{
+    if (port->awaiting_ack || !port->cmd_count)
+        return;
+
+    pio_sm_put(ps2_pio, port->sm, _ps2_frame(port->cmd[0]));
+    port->awaiting_ack = true;
+    port->sent_at = time_us_64();
+}
+
+/**
+ * A command byte is done with, one way or another
+ *
+ * @param port      Port
+ */
+static void _ps2_command_done(ps2_port_t *port)
+{
+    port->awaiting_ack = false;
+    port->cmd_count--;
+    memmove(&port->cmd[0], &port->cmd[1], port->cmd_count);
+}
+
+/**
+ * Hand the keyboard's state to usb_hid.c
+ */
+static inline void _ps2_kbd_report()
+{
+    hid_keyboard_report(HID_VIRTUAL_DEV_ADDR, PS2_KBD_INSTANCE, (const uint8_t *)&kbd.report, sizeof(kbd.report));
+}
+
+/**
+ * Apply a key transition to the keyboard's report, and pass it on if that changed it
+ *
+ * @param usage     HID usage
+ * @param up        true if key release, false if press
+ */
+static void _ps2_kbd_usage(uint8_t usage, bool up)
+{
+    uint8_t bit, pos;
+
+    if (usage >= PS2_HID_MODIFIERS) {
+        bit = 1 << (usage - PS2_HID_MODIFIERS);
+        if (!(kbd.report.modifier & bit) == up)
+            return;
+        kbd.report.modifier ^= bit;
+        _ps2_kbd_report();
+        return;
+    }
+
+    for (pos = 0; pos < 6; pos++)
+        if (kbd.report.keycode[pos] == usage)
+            break;
+
+    if (up) {
+        if (pos == 6)
+            return;
+        // keep the keys held in the order they were pressed
+        memmove(&kbd.report.keycode[pos], &kbd.report.keycode[pos + 1], 5 - pos);
+        kbd.report.keycode[5] = 0;
+    } else {
+        // typematic repeats are dropped (the machine does its own), as is a seventh key: boot reports hold six
+        if (pos < 6)
+            return;
+        for (pos = 0; (pos < 6) && kbd.report.keycode[pos]; pos++);
+        if (pos == 6)
+            return;
+        kbd.report.keycode[pos] = usage;
+    }
+
+    _ps2_kbd_report();
+}
+
+/**
+ * Take a byte from the keyboard
+ *
+ * @param byte      Byte received
+ */
+static void _ps2_kbd_receive(uint8_t byte)
+{
+    uint8_t usage = 0;
+    bool up;
+
+    if (kbd.pause_skip) {
+        kbd.pause_skip--;
+        return;
+    }
+
+    switch (byte) {
+        case PS2_BAT_OK:
+            if (kbd.extended || kbd.release)
+                break;
+            // plugged in (or back from a reset): anything held before is gone, and it needs its leds again
+            memset(&kbd.report, 0, sizeof(kbd.report));
+            _ps2_kbd_report();
+            kbd.leds = 0xff;
+            return;
+
+        case PS2_KBD_EXTENDED:
+            kbd.extended = true;
+            return;
+
+        case PS2_KBD_BREAK:
+            kbd.release = true;
+            return;
+
+        case PS2_KBD_PAUSE:
+            // pause has no break code; it's pressed and let go at once
+            kbd.pause_skip = 7;
+            _ps2_kbd_usage(PS2_HID_PAUSE, false);
+            _ps2_kbd_usage(PS2_HID_PAUSE, true);
+            return;
+
+        case 0x00:
+        case 0xff:
+            // too many keys at once, or an overrun; the next codes still make sense
+            return;
+    }
+
+    if (kbd.extended)
+        usage = (byte < sizeof(set2_extended_keys)) ? set2_extended_keys[byte] : 0;
+    else
+        usage = (byte < sizeof(set2_keys)) ? set2_keys[byte] : 0;
+
+    up = kbd.release;
+    kbd.extended = kbd.release = false;
+
+    if (usage)
+        _ps2_kbd_usage(usage, up);
+}
+
+/**
+ * Send the keyboard its leds, if the machine's have changed
+ *
+ * @param port      Keyboard's port
+ */
+static void _ps2_kbd_leds(ps2_port_t *port)
+{
+    uint8_t hid_leds = platform_leds(),
+            leds;
+    uint8_t command[2] = { PS2_CMD_LEDS };
+
+    // ps/2 has scroll, num and caps lock in bits 0-2; hid has num, caps and scroll
+    leds = ((hid_leds & KEYBOARD_LED_SCROLLLOCK) ? 0x01 : 0)
+        | ((hid_leds & KEYBOARD_LED_NUMLOCK) ? 0x02 : 0)
+        | ((hid_leds & KEYBOARD_LED_CAPSLOCK) ? 0x04 : 0);
+
+    if ((leds == kbd.leds) || port->cmd_count)
+        return;
+
+    command[1] = leds;
+    _ps2_command(port, command, sizeof(command));
+    kbd.leds = leds;
+}
+
+#ifdef HAS_PS2_MOUSE
+/**
+ * Take a byte from the mouse
+ *
+ * @param byte      Byte received
+ */
+static void _ps2_mouse_receive(uint8_t byte)
+{
+    static const uint8_t enable = PS2_CMD_ENABLE;
+    hid_mouse_report_t report = { 0 };
+    int16_t x, y;
+
+    if (!mouse.streaming) {
+        // self test passed, then the device id; then it waits to be told to stream
+        if (mouse.bat && (byte == 0x00)) {
+            mouse.streaming = true;
+            mouse.fill = 0;
+            _ps2_command(&ports[PS2_MOUSE_PORT], &enable, 1);
+        }
+        mouse.bat = (byte == PS2_BAT_OK);
+        return;
+    }
+
+    // the first byte always has bit 3 set; anything else is out of step, so wait for one which could be a start
+    if (!mouse.fill && !(byte & 0x08))
+        return;
+
+    mouse.packet[mouse.fill++] = byte;
+    if (mouse.fill < sizeof(mouse.packet))
+        return;
+    mouse.fill = 0;
+
+    // buttons are left, right, middle in bits 0-2, as in hid. motion is nine bit, with the sign in the first byte;
+    // an overflowed axis counts as the most it could have been. up is positive.
+    report.buttons = mouse.packet[0] & 0x07;
+    x = (mouse.packet[0] & 0x40) ? ((mouse.packet[0] & 0x10) ? -256 : 255)
+        : (int16_t)mouse.packet[1] - ((mouse.packet[0] & 0x10) ? 256 : 0);
+    y = (mouse.packet[0] & 0x80) ? ((mouse.packet[0] & 0x20) ? -256 : 255)
+        : (int16_t)mouse.packet[2] - ((mouse.packet[0] & 0x20) ? 256 : 0);
+    y = -y;
+
+    // a hid report moves at most 127 each way, so larger motion goes as more than one
+    do {
+        report.x = (x > 127) ? 127 : (x < -127) ? -127 : x;
+        report.y = (y > 127) ? 127 : (y < -127) ? -127 : y;
+        x -= report.x;
+        y -= report.y;
+        hid_mouse_report(HID_VIRTUAL_DEV_ADDR, PS2_MOUSE_INSTANCE, (const uint8_t *)&report, sizeof(report));
+    } while (x || y);
+}
+
+/**
+ * Look after a mouse packet which has stopped part way
+ *
+ * @param now       Time now
+ */
+static void _ps2_mouse_stalled(uint64_t now)
+{
+    static const uint8_t enable = PS2_CMD_ENABLE;
+
+    if (!mouse.fill || ((now - ports[PS2_MOUSE_PORT].received_at) < PS2_PACKET_US))
+        return;
+
+    // aa 00 and nothing after it is a mouse being plugged in, which doesn't stream until it's told to
+    if ((mouse.fill == 2) && (mouse.packet[0] == PS2_BAT_OK) && (mouse.packet[1] == 0x00))
+        _ps2_command(&ports[PS2_MOUSE_PORT], &enable, 1);
+
+    mouse.fill = 0;
+}
+#endif // HAS_PS2_MOUSE
+
+void ps2_init()
+{
+    static const uint8_t reset = PS2_CMD_RESET;
+
+    ps2_offset = pio_add_program(ps2_pio, &ps2_host_program);
+
+    for (uint8_t i = 0; i < PS2_PORTS; i++) {
+        ports[i].sm = pio_claim_unused_sm(ps2_pio, true);
+        ps2_host_program_init(ps2_pio, ports[i].sm, ps2_offset, ports[i].dat_pin);
+        pio_set_irq0_source_enabled(ps2_pio, pis_sm0_rx_fifo_not_empty + ports[i].sm, true);
+
+        // whatever is plugged in starts from its power-up state; it'll announce itself with a self test result
+        _ps2_command(&ports[i], &reset, 1);
+    }
+
+    kbd.leds = 0xff;
+
+    irq_add_shared_handler(PIO1_IRQ_0, _ps2_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(PIO1_IRQ_0, true);
+}
+
+void ps2_service()
+{
+    uint64_t now = time_us_64();
+    ps2_port_t *port;
+    uint8_t byte;
+
+    for (uint8_t i = 0; i < PS2_PORTS; i++) {
+        port = &ports[i];
+
+        if (port->resync)
+            _ps2_restart(port);
+
+        while (port->rx_tail != port->rx_head) {
+            byte = port->rx[port->rx_tail];
+            port->rx_tail = (port->rx_tail + 1) & (PS2_RX_SIZE - 1);
+            port->received_at = now;
+
+            if (port->awaiting_ack && (byte == PS2_ACK)) {
+                _ps2_command_done(port);
+                continue;
+            }
+
+            if (port->awaiting_ack && (byte == PS2_RESEND)) {
+                // it goes again below
+                port->awaiting_ack = false;
+                continue;
+            }
+
+            // a self test result only ever follows a reset, so the reset's acknowledgement was lost
+            if (port->awaiting_ack && (port->cmd[0] == PS2_CMD_RESET))
+                _ps2_command_done(port);
+
+            port->receive(byte);
+        }
+
+        if (port->awaiting_ack && ((now - port->sent_at) >= PS2_ACK_US)) {
+            // nothing there, or nothing listening; start again from whatever it says next. the keyboard's leds may
+            // not have been set, so they go again
+            port->awaiting_ack = false;
+            port->cmd_count = 0;
+            if (i == PS2_KBD_PORT)
+                kbd.leds = 0xff;
+        }
+
+        _ps2_command_next(port);
+    }
+
+    _ps2_kbd_leds(&ports[PS2_KBD_PORT]);
+#ifdef HAS_PS2_MOUSE
+    _ps2_mouse_stalled(now);
+#endif
+}
+
+#endif // PS2_HOST
@@ -0,0 +1,29 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * ps/2 keyboard and mouse input, alongside usb.
+ */
+
+#ifndef _PS2_PS2_HOST_H
+#define _PS2_PS2_HOST_H
+
+// ps/2 reports arrive as these instances on HID_VIRTUAL_DEV_ADDR
+#define PS2_KBD_INSTANCE    2
+#define PS2_MOUSE_INSTANCE  3
+
+/**
+ * @brief Start the ps/2 ports and reset whatever is plugged into them; never waits on the devices
+ */
+void ps2_init();
+
+/**
+ * @brief Turn what the devices have sent into reports, and send them their commands; call regularly from the main
+ *        loop
+ */
+void ps2_service();
+
+#endif // _PS2_PS2_HOST_H
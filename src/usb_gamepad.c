@@ -0,0 +1,142 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * usb gamepads and joysticks.
+ *
+ * gamepads don't have a boot protocol, so every one lays its report out differently. the report descriptor is
+ * walked once at mount (see usb_report.c), and where the x and y axes, the hat switch and the first buttons of the
+ * first gamepad or joystick collection are kept as a plan; reading a report is then a few shifts and compares, with
+ * nothing to look up. other axes (a second stick, triggers) and buttons past the third aren't used.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "usb_gamepad.h"
+#include "platform/platform.h"
+
+#include "class/hid/hid.h"
+
+#define USAGE                   USB_REPORT_USAGE
+
+// the collections a gamepad's stick, hat and buttons are in
+static const uint32_t pad_collections[] = {
+    USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_JOYSTICK),
+    USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_GAMEPAD),
+};
+
+// what the hat's eight positions and the first three buttons are on the joystick lines
+static const uint8_t hat_directions[8] = {
+    PLATFORM_JOY_UP, PLATFORM_JOY_UP | PLATFORM_JOY_RIGHT, PLATFORM_JOY_RIGHT, PLATFORM_JOY_DOWN | PLATFORM_JOY_RIGHT,
+    PLATFORM_JOY_DOWN, PLATFORM_JOY_DOWN | PLATFORM_JOY_LEFT, PLATFORM_JOY_LEFT, PLATFORM_JOY_UP | PLATFORM_JOY_LEFT,
+};
+static const uint8_t fire_buttons[3] = { PLATFORM_JOY_FIRE1, PLATFORM_JOY_FIRE2, PLATFORM_JOY_FIRE3 };
+
+/**
+ * Take a field for the plan if it's one we want and don't have yet
+ *
+ * @param pad       Plan
+ * @param usage     Extended usage of the field
+ * @param field     Where it is
+ * @param min       Logical minimum
+ * @param max       Logical maximum
+ * @param remaining Fields of the same input item from this one on, for buttons
+ */
+static void _plan_field(void *pad, uint32_t usage, usb_report_field_t field, int32_t min, int32_t max,
+    uint8_t remaining)
+{
+    usb_gamepad_plan_t *plan = pad;
+    int64_t centre, reach;
+    uint8_t axis;
+
+    switch (usage) {
+        case USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_X):
+        case USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Y):
+            axis = (usage == USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Y));
+            if (plan->axes[axis].size || (field.size > 16) || (max <= min))
+                return;
+
+            // the threshold either side of centre, worked out now so a report only has to compare. a descriptor can
+            // claim any range at all, so this is done wide enough not to overflow; the results are within min..max
+            centre = min + (((int64_t)max - min) / 2);
+            reach = ((((int64_t)max - min) / 2) * USB_GAMEPAD_THRESHOLD) / 100;
+            plan->axes[axis] = field;
+            plan->axis_signed[axis] = (min < 0);
+            plan->low[axis] = centre - reach;
+            plan->high[axis] = centre + ((reach > 0) ? reach : 1);
+            break;
+
+        case USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_HAT_SWITCH):
+            if (plan->hat.size || (field.size > 8))
+                return;
+
+            plan->hat = field;
+            plan->hat_min = min;
+            break;
+
+        case USAGE(HID_USAGE_PAGE_BUTTON, 1):
+            if (plan->buttons.size || (field.size != 1))
+                return;
+
+            plan->buttons = field;
+            plan->buttons.size = (remaining < sizeof(fire_buttons)) ? remaining : sizeof(fire_buttons);
+            break;
+    }
+}
+
+bool usb_gamepad_plan(usb_gamepad_plan_t *plan, uint8_t const *desc, uint16_t len)
+{
+    memset(plan, 0, sizeof(*plan));
+
+    usb_report_walk(
+        desc, len, pad_collections, sizeof(pad_collections) / sizeof(pad_collections[0]), _plan_field, plan,
+        &plan->report_id
+    );
+
+    plan->valid = plan->axes[0].size || plan->axes[1].size || plan->hat.size || plan->buttons.size;
+    return plan->valid;
+}
+
+uint8_t usb_gamepad_read(const usb_gamepad_plan_t *plan, uint8_t const *report, uint16_t len)
+{
+    uint8_t state = 0, axis;
+    int32_t value;
+    uint32_t bits;
+
+    for (axis = 0; axis < 2; axis++) {
+        if (!plan->axes[axis].size)
+            continue;
+
+        if (plan->axis_signed[axis])
+            value = usb_report_signed(report, len, plan->axes[axis]);
+        else
+            value = (int32_t)usb_report_bits(report, len, plan->axes[axis]);
+
+        if (value <= plan->low[axis])
+            state |= axis ? PLATFORM_JOY_UP : PLATFORM_JOY_LEFT;
+        else if (value >= plan->high[axis])
+            state |= axis ? PLATFORM_JOY_DOWN : PLATFORM_JOY_RIGHT;
+    }
+
+    // anything outside the eight positions is the hat at rest
+    if (plan->hat.size) {
+        value = (int32_t)usb_report_bits(report, len, plan->hat) - plan->hat_min;
+        if ((value >= 0) && (value < 8))
+            state |= hat_directions[value];
+    }
+
+    if (plan->buttons.size) {
+        bits = usb_report_bits(report, len, plan->buttons);
+        for (uint8_t i = 0; i < plan->buttons.size; i++) {
+            if (bits & (1u << i))
+                state |= fire_buttons[i];
+        }
+    }
+
+    return state;
+}
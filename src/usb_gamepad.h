@@ -0,0 +1,60 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * usb gamepads and joysticks, read as a digital joystick.
+ */
+
+#ifndef _USB_GAMEPAD_H
+#define _USB_GAMEPAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_report.h"
+
+// how far from centre towards either end a stick has to go to count as a direction, percent
+#ifndef USB_GAMEPAD_THRESHOLD
+#  define USB_GAMEPAD_THRESHOLD 50
+#endif
+
+/**
+ * where to find everything in a gamepad's reports, and what to make of it; worked out from the report descriptor
+ * once at mount, so a report is a handful of shifts and compares
+ */
+typedef struct {
+    bool valid;
+    uint8_t report_id;              // 0 if the reports carry no id
+    usb_report_field_t axes[2];     // x, y
+    bool axis_signed[2];
+    int32_t low[2], high[2];        // an axis at or below low is left/up, at or above high is right/down
+    usb_report_field_t hat;
+    int32_t hat_min;                // logical minimum of the hat: north; the next seven are clockwise from there
+    usb_report_field_t buttons;     // button 1 upwards, a bit each
+} usb_gamepad_plan_t;
+
+/**
+ * @brief Work out a plan for reading a gamepad from its report descriptor
+ *
+ * @param plan      Plan to fill in
+ * @param desc      Report descriptor
+ * @param len       Length of the descriptor
+ * @return true     The device is a gamepad or joystick with a stick, hat or buttons we can use
+ * @return false    It isn't; plan->valid is false
+ */
+bool usb_gamepad_plan(usb_gamepad_plan_t *plan, uint8_t const *desc, uint16_t len);
+
+/**
+ * @brief Read a report with a plan
+ *
+ * @param plan      Plan from usb_gamepad_plan()
+ * @param report    Report, after the report id
+ * @param len       Length of the report
+ * @return uint8_t  PLATFORM_JOY_* bits
+ */
+uint8_t usb_gamepad_read(const usb_gamepad_plan_t *plan, uint8_t const *report, uint16_t len);
+
+#endif // _USB_GAMEPAD_H
@@ -17,48 +17,122 @@
 #include "tusb.h"
 
 // other includes
+#include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
 
 #include "tusb_config.h"
-#include "platform/amiga/keyboard_serial_io.h"  // amiga only, for now, until i get hold of an ST :D
-#include "platform/amiga/keyboard.h"
-#include "platform/amiga/quad_mouse.h"
+#include "config.h"
+#include "usb_hid.h"
+#include "usb_gamepad.h"
+#include "usb_mouse.h"
+#include "usb_profile.h"
+#include "platform/platform.h"
 #include "util/output.h"
 #include "util/debug_cons.h"
 
 // maximum number of reports per hid device
 #define MAX_REPORT 4
 
+// mouse report interval: assumed until one has been measured, and the range a gap between reports must be in to count
+// as one (longer gaps are the mouse being still)
+#define MOUSE_INTERVAL_US       8000
+#define MOUSE_INTERVAL_MIN_US   125
+#define MOUSE_INTERVAL_MAX_US   32000
+
+// controller ports, and the one a device drives (see usb_profile_t.port): mice default to the first and joysticks
+// to the second. on a board which only drives the first, everything goes there, and a mouse and a gamepad can't both
+// have it (see hid_port_claim())
+#define CONTROLLER_PORTS        2
+#ifdef HAS_PORT2
+#  define MOUSE_PORT(slot)      (((slot)->profile->port == USB_PORT_2) ? 1 : 0)
+#  define JOYSTICK_PORT(slot)   (((slot)->profile->port == USB_PORT_1) ? 0 : 1)
+#else
+#  define MOUSE_PORT(slot)      0
+#  define JOYSTICK_PORT(slot)   0
+#endif
+
 // repetitive modifier check macros (@todo probably better iterated in future?)
 #define _SINGLE_MOD_CHECK(hid_mod) \
-    if ((report->modifier & hid_mod) && !(last_report.modifier & hid_mod)) \
-        amiga_hid_modifier(hid_mod, false); \
-    if (!(report->modifier & hid_mod) && (last_report.modifier & hid_mod)) \
-        amiga_hid_modifier(hid_mod, true);
+    if ((report->modifier & hid_mod) && !(last_report->modifier & hid_mod)) \
+        platform_modifier(slot->keymap, hid_mod, false); \
+    if (!(report->modifier & hid_mod) && (last_report->modifier & hid_mod)) \
+        platform_modifier(slot->keymap, hid_mod, true);
 
 #define _MULTI_MOD_CHECK(hid_mod_a, hid_mod_b) \
-    if (((report->modifier & hid_mod_a) && !(last_report.modifier & hid_mod_a)) \
-        || ((report->modifier & hid_mod_b) && !(last_report.modifier & hid_mod_b)) \
+    if (((report->modifier & hid_mod_a) && !(last_report->modifier & hid_mod_a)) \
+        || ((report->modifier & hid_mod_b) && !(last_report->modifier & hid_mod_b)) \
     ) \
-        amiga_hid_modifier(hid_mod_a, false); \
-    if ((!(report->modifier & hid_mod_a) && (last_report.modifier & hid_mod_a)) \
-        || (!(report->modifier & hid_mod_b) && (last_report.modifier & hid_mod_b)) \
+        platform_modifier(slot->keymap, hid_mod_a, false); \
+    if ((!(report->modifier & hid_mod_a) && (last_report->modifier & hid_mod_a)) \
+        || (!(report->modifier & hid_mod_b) && (last_report->modifier & hid_mod_b)) \
     ) \
-        amiga_hid_modifier(hid_mod_a, true);
+        platform_modifier(slot->keymap, hid_mod_a, true);
 
 // textual representations of attached devices
 const uint8_t hid_protocol_type[] = { AP_H_UNKNOWN, AP_H_KEYBOARD, AP_H_MOUSE };
 
+// the interface protocol comes straight from the device descriptor, so don't trust it as an array index
+#define HID_PROTOCOL_TYPE(protocol) \
+    (((protocol) < sizeof(hid_protocol_type)) ? hid_protocol_type[(protocol)] : AP_H_UNKNOWN)
+
+// one slot per hid interface we're servicing: every usb interface tinyusb will mount, plus a few for reports which
+// arrive from elsewhere (see HID_VIRTUAL_DEV_ADDR)
+#define HID_SLOTS (CFG_TUH_HID + HID_VIRTUAL_SLOTS)
+
 // hid information structure
-static struct _hid_info
+typedef struct _hid_info
 {
+    bool in_use;
+    uint8_t dev_addr;
+    uint8_t instance;
     uint8_t report_count;
     tuh_hid_report_info_t report_info[MAX_REPORT];
-} hid_info[CFG_TUH_HID];
-
-static void process_report(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len);
-static void handle_event_keyboard(uint8_t dev_addr, uint8_t instance, hid_keyboard_report_t const *report);
-static void handle_event_mouse(uint8_t dev_addr, uint8_t instance, hid_mouse_report_t const *report);
+    hid_keyboard_report_t last_keyboard;    // keys this interface last reported as held
+    hid_mouse_report_t last_mouse;          // buttons this interface last reported as held
+    const usb_profile_t *profile;           // picked by vid:pid at mount
+    const platform_keymap_t *keymap;           // the profile's layout, or NULL for the default
+    int16_t motion_remainder[2];            // scaled mouse motion not yet sent, in hundredths of a count
+    uint64_t motion_at;                     // when this interface last reported motion
+    uint32_t motion_interval;               // its report interval whilst moving, measured
+    uint8_t macro_key;                      // key which started a macro, kept from the amiga until released
+    uint8_t macro_modifier;                 // modifiers held with it, likewise
+    uint32_t batch;                         // platform_key_batch() when this interface last reported
+    usb_gamepad_plan_t gamepad;             // where to find the stick, hat and buttons, if it's a gamepad
+    usb_mouse_plan_t mouse;                 // where to find the wheel and the rest, if it's a mouse that has one
+    uint8_t joystick;                       // PLATFORM_JOY_* lines this interface last reported as held
+    bool mouse_port;                        // it's a mouse, and drives its port
+    bool joystick_port;                     // it's a gamepad, and drives its port
+    bool leaving;                           // being unmounted; nothing more is sent to it
+} hid_info_t;
+
+static hid_info_t hid_info[HID_SLOTS];
+
+// ctrl-amiga-amiga currently held across all keyboards
+static bool reset_chord = false;
+
+// buttons currently held across all mice on each port
+static uint8_t mouse_buttons[CONTROLLER_PORTS] = { 0 };
+
+// joystick lines currently held across all gamepads on each port
+static uint8_t joystick_lines[CONTROLLER_PORTS] = { 0 };
+
+static hid_info_t *hid_slot(uint8_t dev_addr, uint8_t instance, bool claim);
+static void hid_slot_profile(hid_info_t *slot, const usb_profile_t *profile);
+static void hid_port_claim(hid_info_t *slot, bool mouse);
+static void check_reset_chord(void);
+static void check_mouse_buttons(uint8_t port);
+static void check_joystick(uint8_t port);
+static void release_modifiers(hid_info_t *slot, uint8_t modifier);
+static void process_report(hid_info_t *slot, uint8_t const *report, uint16_t len);
+static void dispatch_keyboard(hid_info_t *slot, uint8_t const *report, uint16_t len);
+static void dispatch_mouse(hid_info_t *slot, uint8_t const *report, uint16_t len);
+static void dispatch_gamepad(hid_info_t *slot, uint8_t report_id, uint8_t const *report, uint16_t len);
+static void handle_event_keyboard(hid_info_t *slot, hid_keyboard_report_t const *report);
+static void handle_event_mouse(hid_info_t *slot, hid_mouse_report_t const *report);
 
 void hid_app_task(void)
 {
@@ -79,18 +153,44 @@ void hid_app_task(void)
 void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const *desc_report, uint16_t desc_len)
 {
     uint8_t hid_protocol = tuh_hid_interface_protocol(dev_addr, instance);
+    hid_info_t *slot;
+    uint16_t vid, pid;
+
+    if ((slot = hid_slot(dev_addr, instance, true)) == NULL) {
+        // more interfaces than we have bookkeeping for; leave it unserviced
+        dbgcons_plug(HID_PROTOCOL_TYPE(hid_protocol));
+        return;
+    }
 
-    dbgcons_plug(hid_protocol_type[hid_protocol]);
+    // look the device up once; reports just follow the pointers from here on
+    if (tuh_vid_pid_get(dev_addr, &vid, &pid))
+        hid_slot_profile(slot, usb_profile_lookup(vid, pid));
 
     // this part doesn't entirely make sense to me; hid devices come in two modes, boot protocol and report;
     // as i understand it, boot proto is intended for simplistic software such as bios which don't want to
     // implement a full stack. so if we're not in boot proto mode, display... something?
     // this might be number of interfaces on a device (think wireless kbd+mouse receiver). maybe. speculation.
-    if (hid_protocol == HID_ITF_PROTOCOL_NONE) {
-        hid_info[instance].report_count = tuh_hid_parse_report_descriptor(hid_info[instance].report_info, MAX_REPORT, desc_report, desc_len);
-        // ahprintf("[PLUG] %02x report(s)\n", hid_info[instance].report_count);
+    if ((hid_protocol == HID_ITF_PROTOCOL_NONE) && (desc_report != NULL) && (desc_len > 0)) {
+        slot->report_count = tuh_hid_parse_report_descriptor(slot->report_info, MAX_REPORT, desc_report, desc_len);
+        // the parser never returns more than it was given room for, but the report path relies on it; clamp anyway
+        if (slot->report_count > MAX_REPORT)
+            slot->report_count = MAX_REPORT;
+        // ahprintf("[PLUG] %02x report(s)\n", slot->report_count);
+
+        // gamepads have no boot protocol to fall back on, so work out where everything is in their reports now
+        usb_gamepad_plan(&slot->gamepad, desc_report, desc_len);
     }
 
+    // boot protocol has no room for a wheel or tilt on most mice, so a mouse with either is switched to report
+    // protocol, and its reports read as a gamepad's are
+    if ((hid_protocol == HID_ITF_PROTOCOL_MOUSE) && (desc_report != NULL) && (desc_len > 0)
+        && usb_mouse_plan(&slot->mouse, desc_report, desc_len))
+        tuh_hid_set_protocol(dev_addr, instance, HID_PROTOCOL_REPORT);
+
+    hid_port_claim(slot, hid_protocol == HID_ITF_PROTOCOL_MOUSE);
+
+    dbgcons_plug(slot->gamepad.valid ? AP_H_CONTROLLER : HID_PROTOCOL_TYPE(hid_protocol));
+
     if (!tuh_hid_receive_report(dev_addr, instance)) {
         // ahprintf("[PLUG] warning! report request failed; delayed initialisation?\n");
     }
@@ -104,9 +204,28 @@ void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const *desc_re
  */
 void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
 {
+    static const hid_keyboard_report_t keyboard_released = { 0, 0, {0} };
+    static const hid_mouse_report_t mouse_released = { 0 };
     uint8_t hid_protocol = tuh_hid_interface_protocol(dev_addr, instance);
+    hid_info_t *slot;
+
+    slot = hid_slot(dev_addr, instance, false);
+    dbgcons_unplug(((slot != NULL) && slot->gamepad.valid) ? AP_H_CONTROLLER : HID_PROTOCOL_TYPE(hid_protocol));
 
-    dbgcons_unplug(hid_protocol_type[hid_protocol]);
+    if (slot == NULL)
+        return;
+
+    // let go of anything the device was holding when it went away, or the amiga sees it held forever (and a chord
+    // held on a keyboard which has just been pulled out would keep the amiga in reset)
+    slot->leaving = true;
+    handle_event_keyboard(slot, &keyboard_released);
+    handle_event_mouse(slot, &mouse_released);
+    if (slot->joystick_port) {
+        slot->joystick = 0;
+        check_joystick(JOYSTICK_PORT(slot));
+    }
+
+    slot->in_use = false;
 }
 
 /**
@@ -119,21 +238,30 @@ void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
  */
 void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len)
 {
-    uint8_t const hid_protocol = tuh_hid_interface_protocol(dev_addr, instance);
+    uint8_t hid_protocol = tuh_hid_interface_protocol(dev_addr, instance);
+    hid_info_t *slot = hid_slot(dev_addr, instance, false);
+
+    if ((report == NULL) || (slot == NULL)) {
+        tuh_hid_receive_report(dev_addr, instance);
+        return;
+    }
+
+    if (slot->profile->quirks & USB_QUIRK_BOOT_KEYBOARD)
+        hid_protocol = HID_ITF_PROTOCOL_KEYBOARD;
 
     switch (hid_protocol) {
         case HID_ITF_PROTOCOL_KEYBOARD:
-            handle_event_keyboard(dev_addr, instance, (hid_keyboard_report_t const *)report);
+            dispatch_keyboard(slot, report, len);
             break;
 
         case HID_ITF_PROTOCOL_MOUSE:
-            handle_event_mouse(dev_addr, instance, (hid_mouse_report_t const *)report);
+            dispatch_mouse(slot, report, len);
             break;
 
         default:
             // if report was not immediately identifiable as a keyboard event, read the usage page;
             // some reports have a classifier as "desktop" for media keys, power, or are just encapsulated.
-            process_report(dev_addr, instance, report, len);
+            process_report(slot, report, len);
             break;
     }
 
@@ -143,6 +271,94 @@ void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t cons
         // ahprintf("[ERROR] unable to receive hid event report\n");
 }
 
+/**
+ * Find the slot belonging to an interface, optionally claiming a free one for it
+ *
+ * @param dev_addr      Address of device
+ * @param instance      Instance of device
+ * @param claim         Claim an empty slot if the interface doesn't have one
+ * @return hid_info_t*  Slot, or NULL if there isn't one (and none was free to claim)
+ */
+static hid_info_t *hid_slot(uint8_t dev_addr, uint8_t instance, bool claim)
+{
+    hid_info_t *free_slot = NULL;
+
+    for (uint8_t i = 0; i < HID_SLOTS; i++) {
+        if (!hid_info[i].in_use) {
+            if (free_slot == NULL)
+                free_slot = &hid_info[i];
+            continue;
+        }
+
+        if ((hid_info[i].dev_addr == dev_addr) && (hid_info[i].instance == instance))
+            return &hid_info[i];
+    }
+
+    if (!claim || (free_slot == NULL))
+        return NULL;
+
+    // forget whatever the previous occupant of this slot told us
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->in_use = true;
+    free_slot->dev_addr = dev_addr;
+    free_slot->instance = instance;
+    free_slot->motion_interval = MOUSE_INTERVAL_US;
+    hid_slot_profile(free_slot, usb_profile_lookup(0, 0));
+
+    return free_slot;
+}
+
+/**
+ * Bind a profile to a slot, resolving its layout now rather than per report
+ *
+ * @param slot      Slot to bind to
+ * @param profile   Device profile
+ */
+static void hid_slot_profile(hid_info_t *slot, const usb_profile_t *profile)
+{
+    slot->profile = profile;
+    // a layout which isn't built in falls back to the default rather than leaving the keyboard dead
+    slot->keymap = profile->keymap ? platform_keymap_find(profile->keymap) : NULL;
+}
+
+/**
+ * Let a mouse or gamepad have its controller port, if nothing of the other kind has it already. the mouse's lines are
+ * driven from core1 and a joystick's from core0, and on the same port they're the same pins; with both there, each
+ * would undo the other. so the first to arrive keeps the port until it's unplugged, and the other is ignored: a
+ * gamepad refused a port has to be plugged in again once the mouse has gone, and the same for a mouse.
+ *
+ * @param slot      Newly mounted interface, its gamepad plan made
+ * @param mouse     It's a boot protocol mouse
+ */
+static void hid_port_claim(hid_info_t *slot, bool mouse)
+{
+    bool mouse_there = false,
+         joystick_there = false;
+
+    // an interface without a boot protocol is a mouse if one of its collections is
+    for (uint8_t i = 0; i < slot->report_count; i++) {
+        if ((slot->report_info[i].usage_page == HID_USAGE_PAGE_DESKTOP)
+            && (slot->report_info[i].usage == HID_USAGE_DESKTOP_MOUSE))
+            mouse = true;
+    }
+
+    for (uint8_t i = 0; i < HID_SLOTS; i++) {
+        if (!hid_info[i].in_use || (&hid_info[i] == slot))
+            continue;
+
+        mouse_there |= hid_info[i].mouse_port && (MOUSE_PORT(&hid_info[i]) == JOYSTICK_PORT(slot));
+        joystick_there |= hid_info[i].joystick_port && (JOYSTICK_PORT(&hid_info[i]) == MOUSE_PORT(slot));
+    }
+
+    slot->mouse_port = mouse && !joystick_there;
+    slot->joystick_port = slot->gamepad.valid && !mouse_there
+        && !(slot->mouse_port && (MOUSE_PORT(slot) == JOYSTICK_PORT(slot)));
+
+    // a mouse that was there before may have left lines low; put them where the gamepads on the port have them
+    if (slot->joystick_port)
+        platform_joystick(JOYSTICK_PORT(slot), joystick_lines[JOYSTICK_PORT(slot)]);
+}
+
 /**
  * HID Boot Protocol keeps a six-key buffer of pressed keys. Return true if keycode is "pressed".
  *
@@ -160,20 +376,136 @@ static inline bool key_pressed(hid_keyboard_report_t const *report, uint8_t keyc
     return false;
 }
 
+/**
+ * Pass a keyboard report of arbitrary length to the keyboard handler. Reports shorter than the boot protocol
+ * structure are zero-padded (i.e. the missing keys are "not pressed") rather than read beyond their end.
+ *
+ * @param slot      Reporting interface
+ * @param report    Address of the report data
+ * @param len       Number of valid bytes at report
+ */
+static void dispatch_keyboard(hid_info_t *slot, uint8_t const *report, uint16_t len)
+{
+    hid_keyboard_report_t keyboard_report = { 0, 0, {0} };
+
+    if (len == 0)
+        return;
+
+    memcpy(&keyboard_report, report, (len < sizeof(keyboard_report)) ? len : sizeof(keyboard_report));
+    handle_event_keyboard(slot, &keyboard_report);
+}
+
+void hid_keyboard_report(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len)
+{
+    // usb interfaces get their slot when they're mounted; anything else gets one the first time it reports
+    hid_info_t *slot = hid_slot(dev_addr, instance, dev_addr == HID_VIRTUAL_DEV_ADDR);
+
+    if (slot != NULL)
+        dispatch_keyboard(slot, report, len);
+}
+
+/**
+ * Pass a mouse report of arbitrary length to the mouse handler, zero-padding short reports (no motion on the
+ * missing axes) as per dispatch_keyboard(). once a mouse has been switched to report protocol, its reports are read
+ * with the plan made at mount instead; until the switch goes through, they're still boot reports. a boot report is
+ * only buttons, x and y: whatever a mouse sends after those is its own business, and taken for a wheel it scrolls or
+ * tilts at random, so the wheel only ever comes from the plan.
+ *
+ * @param slot      Reporting interface
+ * @param report    Address of the report data
+ * @param len       Number of valid bytes at report
+ */
+static void dispatch_mouse(hid_info_t *slot, uint8_t const *report, uint16_t len)
+{
+    hid_mouse_report_t mouse_report = { 0 };
+
+    if (len == 0)
+        return;
+
+    if (slot->mouse.valid && (tuh_hid_get_protocol(slot->dev_addr, slot->instance) == HID_PROTOCOL_REPORT)) {
+        if (!usb_mouse_read(&slot->mouse, report, len, &mouse_report))
+            return;
+    } else {
+        len = (len < offsetof(hid_mouse_report_t, wheel)) ? len : offsetof(hid_mouse_report_t, wheel);
+        memcpy(&mouse_report, report, len);
+    }
+
+    handle_event_mouse(slot, &mouse_report);
+}
+
+/**
+ * Read a gamepad report with the plan made at mount, and pass on the joystick lines if they've changed
+ *
+ * @param slot      Reporting interface
+ * @param report_id Report id, 0 if the interface doesn't use them
+ * @param report    Address of the report data, after the id
+ * @param len       Number of valid bytes at report
+ */
+static void dispatch_gamepad(hid_info_t *slot, uint8_t report_id, uint8_t const *report, uint16_t len)
+{
+    uint8_t state;
+
+    if (!slot->joystick_port || (report_id != slot->gamepad.report_id))
+        return;
+
+    state = usb_gamepad_read(&slot->gamepad, report, len);
+    if (state == slot->joystick)
+        return;
+
+    slot->joystick = state;
+    check_joystick(JOYSTICK_PORT(slot));
+}
+
+void hid_mouse_report(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len)
+{
+    // as hid_keyboard_report()
+    hid_info_t *slot = hid_slot(dev_addr, instance, dev_addr == HID_VIRTUAL_DEV_ADDR);
+
+    if (slot != NULL)
+        dispatch_mouse(slot, report, len);
+}
+
+void hid_virtual_mount(uint8_t instance, uint8_t const *desc_report, uint16_t desc_len)
+{
+    hid_info_t *slot = hid_slot(HID_VIRTUAL_DEV_ADDR, instance, true);
+
+    if (slot == NULL)
+        return;
+
+    // as tuh_hid_mount_cb() for an interface with no boot protocol
+    slot->report_count = tuh_hid_parse_report_descriptor(slot->report_info, MAX_REPORT, desc_report, desc_len);
+    if (slot->report_count > MAX_REPORT)
+        slot->report_count = MAX_REPORT;
+    usb_gamepad_plan(&slot->gamepad, desc_report, desc_len);
+    hid_port_claim(slot, false);
+}
+
+void hid_virtual_report(uint8_t instance, uint8_t const *report, uint16_t len)
+{
+    hid_info_t *slot = hid_slot(HID_VIRTUAL_DEV_ADDR, instance, false);
+
+    if ((report != NULL) && (slot != NULL))
+        process_report(slot, report, len);
+}
+
 /**
  * Process incoming event and pass off to device-centric handler.
  *
- * @param dev_addr  Address of reporting device
- * @param instance  Instance of reporting device
+ * @param slot      Reporting interface
  * @param report    Address of the report data structure
  * @param len       Size of the report event
  */
-static void process_report(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len)
+static void process_report(hid_info_t *slot, uint8_t const *report, uint16_t len)
 {
-    uint8_t const report_count = hid_info[instance].report_count;
-    tuh_hid_report_info_t *report_info_arr = hid_info[instance].report_info;
+    uint8_t const report_count = slot->report_count;
+    tuh_hid_report_info_t *report_info_arr = slot->report_info;
     tuh_hid_report_info_t *report_info = NULL;
 
+    if ((report_count == 0) || (len == 0)) {
+        // nothing parsed from the descriptor (or an empty report); we can't classify it, so don't try
+        return;
+    }
+
     if (report_count == 1 && report_info_arr[0].report_id == 0) {
         // single report with id of 0 is a single-shot report
         report_info = &report_info_arr[0];
@@ -205,12 +537,17 @@ static void process_report(uint8_t dev_addr, uint8_t instance, uint8_t const *re
         switch (report_info->usage) {
             case HID_USAGE_DESKTOP_KEYBOARD:
                 // keyboard event; let's hope it appears as a boot proto event or else this will break
-                handle_event_keyboard(dev_addr, instance, (hid_keyboard_report_t const *) report);
+                dispatch_keyboard(slot, report, len);
                 break;
 
             case HID_USAGE_DESKTOP_MOUSE:
                 // mouse event
-                handle_event_mouse(dev_addr, instance, (hid_mouse_report_t const *) report);
+                dispatch_mouse(slot, report, len);
+                break;
+
+            case HID_USAGE_DESKTOP_JOYSTICK:
+            case HID_USAGE_DESKTOP_GAMEPAD:
+                dispatch_gamepad(slot, report_info->report_id, report, len);
                 break;
 
             default:
@@ -219,74 +556,283 @@ static void process_report(uint8_t dev_addr, uint8_t instance, uint8_t const *re
     }
 }
 
+/**
+ * Apply the device profile's acceleration and scaling to one axis of mouse motion. the part of a count which
+ * scaling leaves over is carried to the next report, so slow movement isn't lost to rounding.
+ *
+ * @param slot      Reporting interface
+ * @param axis      0 for horizontal, 1 for vertical
+ * @param delta     Motion from the report
+ * @return int8_t   Motion to send
+ */
+static int8_t scale_motion(hid_info_t *slot, uint8_t axis, int8_t delta)
+{
+    const usb_profile_t *profile = slot->profile;
+    int32_t motion = delta;
+
+    if ((profile->mouse_scale == 100) && !profile->accel_threshold)
+        return delta;
+
+    if (profile->accel_threshold && (abs(motion) > profile->accel_threshold))
+        motion += ((motion - ((motion < 0) ? -profile->accel_threshold : profile->accel_threshold))
+            * profile->accel_percent) / 100;
+
+    motion = (motion * profile->mouse_scale) + slot->motion_remainder[axis];
+    slot->motion_remainder[axis] = motion % 100;
+    motion /= 100;
+
+    if (motion > 127)
+        return 127;
+    if (motion < -127)
+        return -127;
+
+    return motion;
+}
+
 /**
  * Handle the mouse event sent to us.
  *
- * @param dev_addr  Device address of report
- * @param instance  Instance number of reporting device
+ * @param slot      Reporting interface
  * @param report    Address of hid_mouse_report_t structure of current mouse event
  */
-static void handle_event_mouse(uint8_t dev_addr, uint8_t instance, hid_mouse_report_t const *report)
+static void handle_event_mouse(hid_info_t *slot, hid_mouse_report_t const *report)
 {
-    static hid_mouse_report_t last_report = { 0 };
+    hid_mouse_report_t *last_report = &slot->last_mouse;
+    uint64_t now, gap;
+    int8_t x, y;
 
     if (report == NULL) {
         // ahprintf("[hid] report was null, aborting mouse event\n");
         return;
     }
 
-    // have buttons changed since the last report?
-    if ((report->buttons & MOUSE_BUTTON_LEFT) && !(last_report.buttons & MOUSE_BUTTON_LEFT))
-        amiga_quad_mouse_button(AQM_LEFT, true);
-    if (!(report->buttons & MOUSE_BUTTON_LEFT) && (last_report.buttons & MOUSE_BUTTON_LEFT))
-        amiga_quad_mouse_button(AQM_LEFT, false);
-
-    if ((report->buttons & MOUSE_BUTTON_MIDDLE) && !(last_report.buttons & MOUSE_BUTTON_MIDDLE))
-        amiga_quad_mouse_button(AQM_MIDDLE, true);
-    if (!(report->buttons & MOUSE_BUTTON_MIDDLE) && (last_report.buttons & MOUSE_BUTTON_MIDDLE))
-        amiga_quad_mouse_button(AQM_MIDDLE, false);
+    // a gamepad has the port (see hid_port_claim())
+    if (!slot->mouse_port)
+        return;
 
-    if ((report->buttons & MOUSE_BUTTON_RIGHT) && !(last_report.buttons & MOUSE_BUTTON_RIGHT))
-        amiga_quad_mouse_button(AQM_RIGHT, true);
-    if (!(report->buttons & MOUSE_BUTTON_RIGHT) && (last_report.buttons & MOUSE_BUTTON_RIGHT))
-        amiga_quad_mouse_button(AQM_RIGHT, false);
+    // a button is held on a port whilst any mouse on it holds it, so a click on one isn't undone by another
+    // reporting its buttons up
+    *last_report = *report;
+    check_mouse_buttons(MOUSE_PORT(slot));
 
     // this would spam horrendously, so even when debug messages are on, this is probably... too much.
     // ahprintf("[hid] x: %d y: %d\n", report->x, report->y);
 
-    if (report->x || report->y)
-        amiga_quad_mouse_set_motion(report->x, report->y);
+    if (report->x || report->y) {
+        // the backend spreads motion across the time until the next report, so it needs to know how long that is;
+        // averaged over a few reports, as usb frames and the main loop both jitter it
+        now = time_us_64();
+        gap = now - slot->motion_at;
+        if (slot->motion_at && (gap >= MOUSE_INTERVAL_MIN_US) && (gap <= MOUSE_INTERVAL_MAX_US))
+            slot->motion_interval += ((int32_t)gap - (int32_t)slot->motion_interval) / 4;
+        slot->motion_at = now;
+    }
+
+    x = scale_motion(slot, 0, report->x);
+    y = scale_motion(slot, 1, report->y);
+    if (x || y)
+        platform_mouse_motion(MOUSE_PORT(slot), x, y, slot->motion_interval);
 
-    last_report = *report;
+    if (report->wheel || report->pan)
+        platform_mouse_wheel(report->wheel, report->pan);
 }
 
 static uint8_t led_report = 0;
 
+/**
+ * Send the led state to a keyboard, if it's one we can talk back to
+ *
+ * @param slot      Keyboard interface
+ */
+static void hid_set_leds(hid_info_t *slot)
+{
+    if ((slot->dev_addr != HID_VIRTUAL_DEV_ADDR) && !(slot->profile->quirks & USB_QUIRK_NO_LEDS))
+        tuh_hid_set_report(slot->dev_addr, slot->instance, 0, HID_REPORT_TYPE_OUTPUT, &led_report, 1);
+}
+
+/**
+ * Watch the keys held across every keyboard for ctrl-amiga-amiga, asserting reset when it's made and releasing it
+ * when it's broken. the chord can be spread across keyboards, same as any other key combination.
+ */
+static void check_reset_chord(void)
+{
+    uint8_t modifier = 0;
+    bool menu = false,
+         chord;
+
+    for (uint8_t i = 0; i < HID_SLOTS; i++) {
+        if (!hid_info[i].in_use)
+            continue;
+
+        modifier |= hid_info[i].last_keyboard.modifier;
+        // the menu key is mapped to right amiga as well
+        menu |= key_pressed(&hid_info[i].last_keyboard, HID_KEY_APPLICATION);
+    }
+
+    chord = (modifier & (KEYBOARD_MODIFIER_LEFTCTRL | KEYBOARD_MODIFIER_RIGHTCTRL))
+        && (modifier & KEYBOARD_MODIFIER_LEFTGUI)
+        && ((modifier & KEYBOARD_MODIFIER_RIGHTGUI) || menu);
+
+    if (chord && !reset_chord)
+        platform_reset(true);
+    if (!chord && reset_chord)
+        platform_reset(false);
+
+    reset_chord = chord;
+}
+
+/**
+ * Gather the buttons held across every mouse on a port, and pass on those which have changed
+ *
+ * @param port      Controller port
+ */
+static void check_mouse_buttons(uint8_t port)
+{
+    static const struct {
+        uint8_t hid;
+        enum platform_mouse_buttons button;
+    } buttons[] = {
+        { MOUSE_BUTTON_LEFT,    PLATFORM_MOUSE_LEFT },
+        { MOUSE_BUTTON_MIDDLE,  PLATFORM_MOUSE_MIDDLE },
+        { MOUSE_BUTTON_RIGHT,   PLATFORM_MOUSE_RIGHT },
+    };
+    uint8_t held = 0,
+            changed;
+
+    for (uint8_t i = 0; i < HID_SLOTS; i++) {
+        if (hid_info[i].in_use && hid_info[i].mouse_port && (MOUSE_PORT(&hid_info[i]) == port))
+            held |= hid_info[i].last_mouse.buttons;
+    }
+
+    changed = held ^ mouse_buttons[port];
+    mouse_buttons[port] = held;
+
+    for (uint8_t i = 0; i < (sizeof(buttons) / sizeof(buttons[0])); i++) {
+        if (changed & buttons[i].hid)
+            platform_mouse_button(port, buttons[i].button, held & buttons[i].hid);
+    }
+}
+
+/**
+ * Gather the lines held across every gamepad on a port, and pass them on if they've changed
+ *
+ * @param port      Controller port
+ */
+static void check_joystick(uint8_t port)
+{
+    uint8_t held = 0;
+
+    for (uint8_t i = 0; i < HID_SLOTS; i++) {
+        if (hid_info[i].in_use && hid_info[i].joystick_port && (JOYSTICK_PORT(&hid_info[i]) == port))
+            held |= hid_info[i].joystick;
+    }
+
+    if (held == joystick_lines[port])
+        return;
+
+    joystick_lines[port] = held;
+    platform_joystick(port, held);
+}
+
+/**
+ * Send up codes for modifiers the amiga has already seen pressed
+ *
+ * @param slot      Reporting interface
+ * @param modifier  HID modifier bits
+ */
+static void release_modifiers(hid_info_t *slot, uint8_t modifier)
+{
+    // both ctrls are the one amiga ctrl, as in _MULTI_MOD_CHECK
+    if (modifier & KEYBOARD_MODIFIER_RIGHTCTRL)
+        modifier = (modifier & ~KEYBOARD_MODIFIER_RIGHTCTRL) | KEYBOARD_MODIFIER_LEFTCTRL;
+
+    for (uint8_t bit = 1; bit; bit <<= 1)
+        if (modifier & bit)
+            platform_modifier(slot->keymap, bit, true);
+}
+
 /**
  * Handle the keyboard event sent to us.
  *
- * @param dev_addr  Device address of report
- * @param instance  Instance number of reporting device
+ * @param slot      Reporting interface
  * @param report    Address of hid_keyboard_report_t structure of current keyboard event (boot proto?)
  */
-static void handle_event_keyboard(uint8_t dev_addr, uint8_t instance, hid_keyboard_report_t const *report)
+static void handle_event_keyboard(hid_info_t *slot, hid_keyboard_report_t const *report)
 {
-    // keep hold of older key event reports; init empty keyboard report
-    static hid_keyboard_report_t last_report = { 0, 0, {0} };
+    // keep hold of older key event reports per interface, so two keyboards don't release each other's keys
+    hid_keyboard_report_t last_copy = slot->last_keyboard;
+    hid_keyboard_report_t const *last_report = &last_copy;
+    hid_keyboard_report_t swapped, out_report;
     uint8_t pos;
 
+    if (slot->profile->quirks & USB_QUIRK_SWAP_ALT_GUI) {
+        // alt and gui are bits 2/3 (left) and 6/7 (right); trade each pair
+        swapped = *report;
+        swapped.modifier = (report->modifier & 0x33) | ((report->modifier & 0x44) << 1) | ((report->modifier & 0x88) >> 1);
+        report = &swapped;
+    }
+
+    ahtrace(
+        "trace hid %02x:%02x %02x %02x %02x %02x %02x %02x %02x\n",
+        slot->dev_addr, slot->instance, report->modifier,
+        report->keycode[0], report->keycode[1], report->keycode[2],
+        report->keycode[3], report->keycode[4], report->keycode[5]
+    );
+
+    // the reset chord is judged on what's held now, before anything is queued for the amiga; once it's asserted
+    // the queue is dropped and nothing more goes out until it's released, so it can't wait behind a backlog
+    slot->last_keyboard = *report;
+    check_reset_chord();
+
+    // transitions go out in canonical order per batch, which is only right within one report; a second report from
+    // the same keyboard before the batch is flushed must come after the first, so it starts a batch of its own
+    if (slot->batch == platform_key_batch())
+        platform_key_flush();
+    slot->batch = platform_key_batch();
+
+    // a new keypress may start a macro. the modifiers held with it are let go on the amiga side first, so they
+    // don't combine with what the macro types, and neither they nor the key go any further until released.
+    for (pos = 0; pos < 6; pos++) {
+        if (!slot->macro_key && report->keycode[pos] && !key_pressed(last_report, report->keycode[pos])
+            && platform_macro_trigger(report->modifier, report->keycode[pos])
+        ) {
+            slot->macro_key = report->keycode[pos];
+            slot->macro_modifier = report->modifier;
+            release_modifiers(slot, report->modifier & last_report->modifier);
+        }
+    }
+
+    if (slot->macro_key || slot->macro_modifier) {
+        out_report = *report;
+        out_report.modifier &= ~slot->macro_modifier;
+        last_copy.modifier &= ~slot->macro_modifier;
+
+        for (pos = 0; pos < 6; pos++) {
+            if (out_report.keycode[pos] == slot->macro_key)
+                out_report.keycode[pos] = 0;
+            if (last_copy.keycode[pos] == slot->macro_key)
+                last_copy.keycode[pos] = 0;
+        }
+
+        if (!key_pressed(report, slot->macro_key))
+            slot->macro_key = 0;
+        slot->macro_modifier &= report->modifier;
+
+        report = &out_report;
+    }
+
     // check to see if a keypress is a new keypress or in the last report
     for (pos = 0; pos < 6; pos++) {
-        if (report->keycode[pos] && !key_pressed(&last_report, report->keycode[pos])) {
+        if (report->keycode[pos] && !key_pressed(last_report, report->keycode[pos])) {
             // this is a new keypress; pass on to the amiga as a down event
             // @todo right now, menu and right gui are both mapped to right amiga; if one is released, an ramiga up is sent
             // probably something which can be fixed in keyboard_serial_io.c
-            amiga_hid_send(report->keycode[pos], false);
+            platform_key(slot->keymap, report->keycode[pos], false);
         }
 
-        if (last_report.keycode[pos] && !key_pressed(report, last_report.keycode[pos])) {
+        if (last_report->keycode[pos] && !key_pressed(report, last_report->keycode[pos])) {
             // key has been released; send "up" code to amiga
-            amiga_hid_send(last_report.keycode[pos], true);
+            platform_key(slot->keymap, last_report->keycode[pos], true);
         }
     }
 
@@ -300,21 +846,24 @@ static void handle_event_keyboard(uint8_t dev_addr, uint8_t instance, hid_keyboa
     // @todo menu key vs right gui thing; see above
     _SINGLE_MOD_CHECK(KEYBOARD_MODIFIER_RIGHTGUI);
 
-    if (amiga_caps_lock()) {
+    // an interface on its way out can't be told anything; the led change waits for the next keyboard to report
+    if (slot->leaving)
+        return;
+
+    if (platform_leds() & KEYBOARD_LED_CAPSLOCK) {
         if (!(led_report & KEYBOARD_LED_CAPSLOCK)) {
             led_report |= KEYBOARD_LED_CAPSLOCK;
 
             // ahprintf("[hid] turning caps lock led on\n");
-            tuh_hid_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &led_report, 1);
+            hid_set_leds(slot);
         }
     } else {
         if (led_report & KEYBOARD_LED_CAPSLOCK) {
             led_report &= ~KEYBOARD_LED_CAPSLOCK;
 
             // ahprintf("[hid] turning caps lock led off\n");
-            tuh_hid_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &led_report, 1);
+            hid_set_leds(slot);
         }
     }
 
-    last_report = *report;
 }
@@ -0,0 +1,65 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * human interface device handling.
+ */
+
+#ifndef _USB_HID_H
+#define _USB_HID_H
+
+#include <stdint.h>
+
+// reports which don't come from a usb device (the benchmark, injection, ps/2) use device address 0, which usb only
+// ever uses whilst enumerating; each distinct instance on it gets its own keyboard or mouse state
+#define HID_VIRTUAL_DEV_ADDR    0
+#define HID_VIRTUAL_SLOTS       4
+
+/**
+ * @brief Null task to satisfy the stack
+ */
+void hid_app_task(void);
+
+/**
+ * @brief Feed a keyboard report into the same path as reports arriving from a usb keyboard
+ *
+ * @param dev_addr  Address of the reporting device, or HID_VIRTUAL_DEV_ADDR
+ * @param instance  Instance of the reporting device
+ * @param report    Address of the report data (boot protocol layout; short reports are zero-padded)
+ * @param len       Number of valid bytes at report
+ */
+void hid_keyboard_report(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len);
+
+/**
+ * @brief Feed a mouse report into the same path as reports arriving from a usb mouse
+ *
+ * @param dev_addr  Address of the reporting device, or HID_VIRTUAL_DEV_ADDR
+ * @param instance  Instance of the reporting device
+ * @param report    Address of the report data (boot protocol layout; short reports are zero-padded)
+ * @param len       Number of valid bytes at report
+ */
+void hid_mouse_report(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len);
+
+/**
+ * @brief Set up a virtual interface from a report descriptor, as a usb interface without a boot protocol is at mount
+ *
+ * @param instance      Instance on HID_VIRTUAL_DEV_ADDR
+ * @param desc_report   Report descriptor
+ * @param desc_len      Length of the descriptor
+ */
+void hid_virtual_mount(uint8_t instance, uint8_t const *desc_report, uint16_t desc_len);
+
+/**
+ * @brief Feed a report to a virtual interface set up by hid_virtual_mount(), through the same path as a report from
+ *        a usb interface without a boot protocol
+ *
+ * @param instance  Instance on HID_VIRTUAL_DEV_ADDR
+ * @param report    Address of the report data, including any report id
+ * @param len       Number of valid bytes at report
+ */
+void hid_virtual_report(uint8_t instance, uint8_t const *report, uint16_t len);
+
+#endif // _USB_HID_H
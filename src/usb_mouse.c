@@ -0,0 +1,112 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * usb mice in report protocol.
+ *
+ * the boot protocol report stops after x and y on most mice, so the wheel and tilt never arrive in it. a mouse whose
+ * report descriptor has either is switched to report protocol at mount, and its reports are read with a plan made
+ * from the descriptor (see usb_report.c) into the boot layout, so the rest of the mouse path doesn't change.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "usb_mouse.h"
+
+#include "class/hid/hid.h"
+
+#define USAGE                   USB_REPORT_USAGE
+
+// the collection a mouse's pointer, buttons and wheel are in
+static const uint32_t mouse_collections[] = {
+    USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_MOUSE),
+};
+
+/**
+ * Take a field for the plan if it's one we want and don't have yet
+ *
+ * @param mouse     Plan
+ * @param usage     Extended usage of the field
+ * @param field     Where it is
+ * @param min       Logical minimum
+ * @param max       Logical maximum
+ * @param remaining Fields of the same input item from this one on, for buttons
+ */
+static void _plan_field(void *mouse, uint32_t usage, usb_report_field_t field, int32_t min, int32_t max,
+    uint8_t remaining)
+{
+    usb_mouse_plan_t *plan = mouse;
+    usb_report_field_t *axis;
+
+    switch (usage) {
+        case USAGE(HID_USAGE_PAGE_BUTTON, 1):
+            if (plan->buttons.size || (field.size != 1))
+                return;
+
+            plan->buttons = field;
+            plan->buttons.size = (remaining < 8) ? remaining : 8;
+            return;
+
+        case USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_X):        axis = &plan->x; break;
+        case USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Y):        axis = &plan->y; break;
+        case USAGE(HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_WHEEL):    axis = &plan->wheel; break;
+        case USAGE(HID_USAGE_PAGE_CONSUMER, HID_USAGE_CONSUMER_AC_PAN): axis = &plan->pan; break;
+
+        default:
+            return;
+    }
+
+    // relative axes run either side of 0; one that doesn't is absolute (a tablet, say), and no use as a mouse
+    if (axis->size || (field.size > 16) || (min >= 0))
+        return;
+
+    *axis = field;
+}
+
+/**
+ * Fit a relative axis into a boot report's byte; a mouse moving further than that in one report is rare, and it's
+ * only the excess of that one report which is lost
+ *
+ * @param value     Axis value
+ * @return int8_t   Clamped
+ */
+static inline int8_t _mouse_clamp(int32_t value)
+{
+    return (value < INT8_MIN) ? INT8_MIN : (value > INT8_MAX) ? INT8_MAX : value;
+}
+
+bool usb_mouse_plan(usb_mouse_plan_t *plan, uint8_t const *desc, uint16_t len)
+{
+    memset(plan, 0, sizeof(*plan));
+
+    usb_report_walk(
+        desc, len, mouse_collections, sizeof(mouse_collections) / sizeof(mouse_collections[0]), _plan_field, plan,
+        &plan->report_id
+    );
+
+    plan->valid = plan->x.size && plan->y.size && (plan->wheel.size || plan->pan.size);
+    return plan->valid;
+}
+
+bool usb_mouse_read(const usb_mouse_plan_t *plan, uint8_t const *report, uint16_t len, hid_mouse_report_t *out)
+{
+    if (plan->report_id) {
+        if (!len || (report[0] != plan->report_id))
+            return false;
+        report++;
+        len--;
+    }
+
+    out->buttons = usb_report_bits(report, len, plan->buttons);
+    out->x = _mouse_clamp(usb_report_signed(report, len, plan->x));
+    out->y = _mouse_clamp(usb_report_signed(report, len, plan->y));
+    out->wheel = _mouse_clamp(usb_report_signed(report, len, plan->wheel));
+    out->pan = _mouse_clamp(usb_report_signed(report, len, plan->pan));
+
+    return true;
+}
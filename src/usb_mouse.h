@@ -0,0 +1,57 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * usb mice in report protocol, for the wheel and tilt that boot protocol doesn't carry.
+ */
+
+#ifndef _USB_MOUSE_H
+#define _USB_MOUSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_report.h"
+
+#include "class/hid/hid.h"
+
+/**
+ * where to find everything in a mouse's reports; worked out from the report descriptor once at mount, as for a
+ * gamepad (see usb_gamepad.h)
+ */
+typedef struct {
+    bool valid;
+    uint8_t report_id;              // 0 if the reports carry no id
+    usb_report_field_t buttons;     // button 1 upwards, a bit each, up to eight
+    usb_report_field_t x, y;        // relative, signed
+    usb_report_field_t wheel;       // vertical wheel, signed
+    usb_report_field_t pan;         // tilt (ac pan), signed
+} usb_mouse_plan_t;
+
+/**
+ * @brief Work out a plan for reading a mouse from its report descriptor
+ *
+ * @param plan      Plan to fill in
+ * @param desc      Report descriptor
+ * @param len       Length of the descriptor
+ * @return true     The device is a mouse with a wheel or tilt, worth taking out of boot protocol for
+ * @return false    It isn't; plan->valid is false
+ */
+bool usb_mouse_plan(usb_mouse_plan_t *plan, uint8_t const *desc, uint16_t len);
+
+/**
+ * @brief Read a report protocol report with a plan, into the boot protocol layout
+ *
+ * @param plan      Plan from usb_mouse_plan()
+ * @param report    Report, including the report id if there is one
+ * @param len       Length of the report
+ * @param out       Report in boot protocol layout, with wheel and pan filled in
+ * @return true     Read
+ * @return false    Not the report the plan is for
+ */
+bool usb_mouse_read(const usb_mouse_plan_t *plan, uint8_t const *report, uint16_t len, hid_mouse_report_t *out);
+
+#endif // _USB_MOUSE_H
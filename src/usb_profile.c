@@ -0,0 +1,49 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * per-device profiles, picked by usb vid:pid when a device is mounted.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "usb_profile.h"
+
+// anything without an entry of its own: power-up layout, 1:1 motion, no quirks, the usual port
+static const usb_profile_t default_profile = { 0, 0, "default", NULL, 100, 0, 0, 0, USB_PORT_AUTO };
+
+/**
+ * device profiles. add a line per keyboard or mouse which wants something other than the default; the vid:pid is
+ * shown by lsusb, or in device manager under hardware ids. for example:
+ *
+ *  vid     pid          name             keymap  scale accel thr/%  quirks                  port
+ * { 0x1234, 0x5678,      "desk 2 keyboard", "de",  100,  0,   0,    USB_QUIRK_SWAP_ALT_GUI, USB_PORT_AUTO },
+ * { 0x1234, USB_PID_ANY, "desk 2 mice",     NULL,  50,   4,   100,  0,                      USB_PORT_AUTO },
+ * { 0x5678, 0x0001,      "player 2 mouse",  NULL,  100,  0,   0,    0,                      USB_PORT_2 },
+ * { 0x5678, 0x0002,      "player 1 pad",    NULL,  100,  0,   0,    0,                      USB_PORT_1 },
+ */
+static const usb_profile_t profiles[] = {
+    { 0, 0, NULL, NULL, 0, 0, 0, 0, 0 } // end of list
+};
+
+const usb_profile_t *usb_profile_lookup(uint16_t vid, uint16_t pid)
+{
+    const usb_profile_t *vendor = NULL;
+
+    for (const usb_profile_t *profile = profiles; profile->name != NULL; profile++) {
+        if (profile->vid != vid)
+            continue;
+
+        if (profile->pid == pid)
+            return profile;
+
+        if ((profile->pid == USB_PID_ANY) && (vendor == NULL))
+            vendor = profile;
+    }
+
+    return vendor ? vendor : &default_profile;
+}
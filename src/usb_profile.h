@@ -0,0 +1,50 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * per-device profiles, picked by usb vid:pid when a device is mounted.
+ */
+
+#ifndef _USB_PROFILE_H
+#define _USB_PROFILE_H
+
+#include <stdint.h>
+
+// matches any product from the vendor; exact vid:pid entries are preferred over these
+#define USB_PID_ANY             0xffff
+
+// quirks
+#define USB_QUIRK_NO_LEDS       0x01    // never send the led report; some keyboards stall or drop off the bus on it
+#define USB_QUIRK_SWAP_ALT_GUI  0x02    // swap alt and gui, so the keys either side of space are the amiga keys
+#define USB_QUIRK_BOOT_KEYBOARD 0x04    // every report is a boot protocol keyboard report, whatever the descriptor says
+
+// controller port a mouse or gamepad drives
+#define USB_PORT_AUTO           0       // mice to port 1 (the mouse port), gamepads to port 2 (the joystick port)
+#define USB_PORT_1              1
+#define USB_PORT_2              2
+
+typedef struct {
+    uint16_t vid;
+    uint16_t pid;               // or USB_PID_ANY
+    const char *name;           // for the debug console
+    const char *keymap;         // keyboard layout name, NULL for the one selected at power-up
+    uint16_t mouse_scale;       // mouse motion, percent
+    uint8_t accel_threshold;    // counts per report beyond which motion is accelerated; 0 for no acceleration
+    uint16_t accel_percent;     // extra motion beyond the threshold, percent
+    uint8_t quirks;             // USB_QUIRK_*
+    uint8_t port;               // USB_PORT_*
+} usb_profile_t;
+
+/**
+ * @brief Find the profile for a device; devices without one of their own get the default
+ *
+ * @param vid       USB vendor id
+ * @param pid       USB product id
+ * @return const usb_profile_t* Profile; never NULL
+ */
+const usb_profile_t *usb_profile_lookup(uint16_t vid, uint16_t pid);
+
+#endif // _USB_PROFILE_H
@@ -0,0 +1,156 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * hid report descriptors.
+ *
+ * devices without a boot protocol (or with more than it carries) lay their reports out however they like, and say
+ * how in the report descriptor. it's walked once at mount, and the fields of interest are handed to whoever is
+ * making a plan of them (usb_gamepad.c, usb_mouse.c); reading a report is then a few shifts, with nothing to look up.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_report.h"
+
+#include "class/hid/hid.h"
+
+// report descriptor item prefixes, without the size bits
+#define ITEM_INPUT              0x80
+#define ITEM_COLLECTION         0xa0
+#define ITEM_END_COLLECTION     0xc0
+#define ITEM_USAGE_PAGE         0x04
+#define ITEM_LOGICAL_MIN        0x14
+#define ITEM_LOGICAL_MAX        0x24
+#define ITEM_REPORT_SIZE        0x74
+#define ITEM_REPORT_ID          0x84
+#define ITEM_REPORT_COUNT       0x94
+#define ITEM_USAGE              0x08
+#define ITEM_USAGE_MIN          0x18
+#define ITEM_USAGE_MAX          0x28
+#define ITEM_LONG               0xfe
+
+#define ITEM_TYPE(prefix)       (((prefix) >> 2) & 3)   // 0 main, 1 global, 2 local
+#define ITEM_CONSTANT           0x01                    // input item data: padding
+#define ITEM_VARIABLE           0x02                    // input item data: a field per usage, rather than an array
+
+// the most usages listed ahead of one main item that are kept; the last one kept repeats for the rest
+#define MAX_USAGES              16
+
+#define USAGE                   USB_REPORT_USAGE
+
+bool usb_report_walk(uint8_t const *desc, uint16_t len, const uint32_t *collections, uint8_t count,
+    usb_report_field_fn field_fn, void *plan, uint8_t *report_id)
+{
+    uint32_t usages[MAX_USAGES], usage_min = 0, usage_max = 0, usage, data;
+    uint32_t report_size = 0, report_count = 0;
+    uint16_t page = 0, pos = 0, offset = 0;
+    int32_t logical_min = 0, logical_max = 0, sdata;
+    uint8_t prefix, size, usage_count = 0, current_id = 0, depth = 0, want_depth = 0;
+    bool taken = false;
+
+    *report_id = 0;
+
+    while (pos < len) {
+        prefix = desc[pos];
+
+        if (prefix == ITEM_LONG) {
+            // nothing we want is ever a long item
+            if ((pos + 1) >= len)
+                break;
+            pos += 3 + desc[pos + 1];
+            continue;
+        }
+
+        size = ((prefix & 3) == 3) ? 4 : (prefix & 3);
+        if ((pos + 1 + size) > len)
+            break;
+
+        data = 0;
+        for (uint8_t i = 0; i < size; i++)
+            data |= (uint32_t)desc[pos + 1 + i] << (8 * i);
+        sdata = (size == 1) ? (int8_t)data : (size == 2) ? (int16_t)data : (int32_t)data;
+        pos += 1 + size;
+
+        switch (prefix & 0xfc) {
+            case ITEM_USAGE_PAGE:   page = data; break;
+            case ITEM_LOGICAL_MIN:  logical_min = sdata; break;
+            // a maximum is only negative where the minimum is
+            case ITEM_LOGICAL_MAX:  logical_max = (logical_min < 0) ? sdata : (int32_t)data; break;
+            case ITEM_REPORT_SIZE:  report_size = data; break;
+            case ITEM_REPORT_COUNT: report_count = data; break;
+
+            case ITEM_REPORT_ID:
+                // each report id counts its bits from the start of its own report
+                current_id = data;
+                offset = 0;
+                break;
+
+            // the page of a short usage is the one in force at the main item; 0 stands in for it until then
+            case ITEM_USAGE:
+                if (usage_count < MAX_USAGES)
+                    usages[usage_count++] = (size == 4) ? data : USAGE(0, data);
+                break;
+            case ITEM_USAGE_MIN:    usage_min = (size == 4) ? data : USAGE(0, data); break;
+            case ITEM_USAGE_MAX:    usage_max = (size == 4) ? data : USAGE(0, data); break;
+
+            case ITEM_COLLECTION:
+                depth++;
+                usage = usage_count ? usages[0] : 0;
+                if (!(usage >> 16))
+                    usage |= USAGE(page, 0);
+                if (!want_depth && (data == HID_COLLECTION_APPLICATION)) {
+                    for (uint8_t i = 0; i < count; i++) {
+                        if (usage == collections[i])
+                            want_depth = depth;
+                    }
+                }
+                break;
+
+            case ITEM_END_COLLECTION:
+                // the first collection wanted is the one walked; any others on the interface are ignored
+                if (want_depth && (depth == want_depth))
+                    pos = len;
+                if (depth)
+                    depth--;
+                break;
+
+            case ITEM_INPUT:
+                if (want_depth && !(data & ITEM_CONSTANT) && (data & ITEM_VARIABLE)
+                    && (!taken || (current_id == *report_id))) {
+                    for (uint32_t i = 0; (i < report_count) && (i < 0xff); i++) {
+                        if (usage_count)
+                            usage = usages[(i < usage_count) ? i : (usage_count - 1)];
+                        else
+                            usage = ((usage_min + i) <= usage_max) ? (usage_min + i) : usage_max;
+                        if (!(usage >> 16))
+                            usage |= USAGE(page, 0);
+
+                        field_fn(
+                            plan, usage,
+                            (usb_report_field_t){ offset + (i * report_size), report_size },
+                            logical_min, logical_max,
+                            (report_count - i > 0xff) ? 0xff : (report_count - i)
+                        );
+                    }
+
+                    *report_id = current_id;
+                    taken = true;
+                }
+                offset += report_size * report_count;
+                break;
+        }
+
+        // usages belong to the main item they come before, and no further
+        if (ITEM_TYPE(prefix) == 0) {
+            usage_count = 0;
+            usage_min = usage_max = 0;
+        }
+    }
+
+    return taken;
+}
@@ -0,0 +1,93 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * hid report descriptors, walked once at mount to find where fields are in a device's reports.
+ */
+
+#ifndef _USB_REPORT_H
+#define _USB_REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// usages are kept with their page in the top half, as an extended (four byte) usage gives them
+#define USB_REPORT_USAGE(page, id)  (((uint32_t)(page) << 16) | (id))
+
+// where a field sits in the report: bit offset (after any report id) and width; a width of 0 means it's absent
+typedef struct {
+    uint16_t offset;
+    uint8_t size;
+} usb_report_field_t;
+
+/**
+ * a field of an input item, handed over by usb_report_walk()
+ *
+ * @param plan      Whatever the caller is filling in
+ * @param usage     Extended usage of the field
+ * @param field     Where it is
+ * @param min       Logical minimum
+ * @param max       Logical maximum
+ * @param remaining Fields of the same input item from this one on, for buttons
+ */
+typedef void (*usb_report_field_fn)(void *plan, uint32_t usage, usb_report_field_t field, int32_t min, int32_t max,
+    uint8_t remaining);
+
+/**
+ * @brief Walk a report descriptor, handing each variable input field of the first application collection with one
+ *        of the given usages to a callback. only the first report id with inputs in that collection is walked.
+ *
+ * @param desc          Report descriptor
+ * @param len           Length of the descriptor
+ * @param collections   Extended usages of the application collections wanted
+ * @param count         Number of them
+ * @param field_fn      Called for each field
+ * @param plan          Passed to field_fn
+ * @param report_id     Set to the report id the fields are in, 0 if the reports carry no id
+ * @return true         The collection was found and had inputs
+ * @return false        It wasn't, or had none
+ */
+bool usb_report_walk(uint8_t const *desc, uint16_t len, const uint32_t *collections, uint8_t count,
+    usb_report_field_fn field_fn, void *plan, uint8_t *report_id);
+
+/**
+ * @brief Pull a field out of a report; little endian, and anything past the end of the report reads as 0
+ *
+ * @param report    Report, after the report id
+ * @param len       Length of the report
+ * @param field     Field, no more than 16 bits
+ * @return uint32_t Field value, unsigned
+ */
+static inline uint32_t usb_report_bits(uint8_t const *report, uint16_t len, usb_report_field_t field)
+{
+    uint16_t byte = field.offset >> 3;
+    uint32_t value = 0;
+
+    for (uint8_t i = 0; (i < 3) && ((byte + i) < len); i++)
+        value |= (uint32_t)report[byte + i] << (8 * i);
+
+    return (value >> (field.offset & 7)) & ((1u << field.size) - 1);
+}
+
+/**
+ * @brief Pull a signed field out of a report, as usb_report_bits()
+ *
+ * @param report    Report, after the report id
+ * @param len       Length of the report
+ * @param field     Field, no more than 16 bits
+ * @return int32_t  Field value, sign extended
+ */
+static inline int32_t usb_report_signed(uint8_t const *report, uint16_t len, usb_report_field_t field)
+{
+    uint32_t bits = usb_report_bits(report, len, field);
+
+    if (field.size && (bits & (1u << (field.size - 1))))
+        bits |= ~((1u << field.size) - 1);
+
+    return (int32_t)bits;
+}
+
+#endif // _USB_REPORT_H
@@ -13,12 +13,19 @@
 
 #include "debug_cons.h"
 #include "display/disp_ssd.h"
+#ifdef PLATFORM_AMIGA
+#  include "platform/amiga/keyboard_serial_io.h"
+#  include "platform/amiga/quad_mouse.h"
+#endif
 #include "output.h"
 
+#include "pico/stdlib.h"
+
 struct
 {
     uint8_t hid_keyboard, hid_mouse, hid_controller;
     uint8_t plug_events, unplug_events;
+    uint32_t first_keyboard_us;     // time from boot until the first keyboard was mounted
 } debug_counters;
 
 void dbgcons_init()
@@ -32,6 +39,7 @@ void dbgcons_init()
     debug_counters.hid_controller = 0;
     debug_counters.plug_events = 0;
     debug_counters.unplug_events = 0;
+    debug_counters.first_keyboard_us = 0;
 
     dbgcons_print_counters();
 }
@@ -67,6 +75,8 @@ void dbgcons_plug(enum debug_plug_types devtype)
     switch (devtype) {
         case AP_H_KEYBOARD:
             debug_counters.hid_keyboard++;
+            if (!debug_counters.first_keyboard_us)
+                debug_counters.first_keyboard_us = time_us_32();
             break;
         case AP_H_MOUSE:
             debug_counters.hid_mouse++;
@@ -122,6 +132,117 @@ void dbgcons_amiga_key(uint8_t incode, uint8_t outcode, char *updown)
     disp_write(0, 1, linebuf);
 }
 
+#ifdef PLATFORM_AMIGA
+void dbgcons_aqm_stats()
+{
+    static uint32_t last_lost[AQM_PORTS] = { 0 };
+    amiga_quad_mouse_stats_t stats;
+    uint32_t lost;
+    uint8_t port;
+
+    // only when motion has been dropped since last time; the ports share the row, the latest wins
+    for (port = 0; port < AQM_PORTS; port++) {
+        amiga_quad_mouse_stats(port, &stats);
+        lost = stats.lost[0] + stats.lost[1];
+        if (lost == last_lost[port])
+            continue;
+        last_lost[port] = lost;
+
+        ahprintf(
+            VT_CUP_POS VT_EL_LIN
+            "[aqm%d] x req: %lu out: %lu lost: %lu / y req: %lu out: %lu lost: %lu\n",
+            5, 1,
+            port + 1,
+            stats.requested[0], stats.sent[0], stats.lost[0],
+            stats.requested[1], stats.sent[1], stats.lost[1]
+        );
+    }
+}
+#endif // PLATFORM_AMIGA
+
+void dbgcons_disp_stats()
+{
+    static uint32_t last_frames = 0;
+    disp_ssd_stats_t stats;
+
+    disp_ssd_stats(&stats);
+    if (stats.frames == last_frames)
+        return;
+    last_frames = stats.frames;
+
+    ahprintf(
+        VT_CUP_POS VT_EL_LIN
+        "[disp] frames: %lu last: %lu bytes %lu us / total: %lu trans %lu bytes %lu us\n",
+        6, 1,
+        stats.frames, stats.frame_bytes, stats.frame_bus_us,
+        stats.transactions, stats.bytes, stats.bus_us
+    );
+}
+
+#ifdef PLATFORM_AMIGA
+void dbgcons_ready()
+{
+    static uint32_t last_ready = 0,
+                    last_keyboard = 0,
+                    last_resets = 0;
+    uint32_t ready = amiga_ready_us(),
+             resets = amiga_host_resets();
+
+    // boot timing; the amiga side repeats after every reset, so print whenever any of it changes
+    if ((ready == last_ready) && (debug_counters.first_keyboard_us == last_keyboard) && (resets == last_resets))
+        return;
+    last_ready = ready;
+    last_keyboard = debug_counters.first_keyboard_us;
+    last_resets = resets;
+
+    ahprintf(
+        VT_CUP_POS VT_EL_LIN
+        "[boot] amiga ready: %lu ms first keyboard: %lu ms amiga resets: %lu\n",
+        7, 1,
+        ready / 1000, last_keyboard / 1000, resets
+    );
+}
+
+void dbgcons_kbd_timing()
+{
+    static uint32_t last_acks = 0,
+                    last_missed = 0,
+                    last_dropped = 0;
+    amiga_kbd_timing_t timing;
+
+    amiga_kbd_timing(&timing);
+    if ((timing.acks == last_acks) && (timing.missed_acks == last_missed) && (timing.dropped == last_dropped))
+        return;
+    last_acks = timing.acks;
+    last_missed = timing.missed_acks;
+    last_dropped = timing.dropped;
+
+    ahprintf(
+        VT_CUP_POS VT_EL_LIN
+        "[akb] ack estimate: %lu us acks: %lu missed: %lu dropped: %lu\n",
+        8, 1,
+        timing.ack_estimate_us, timing.acks, timing.missed_acks, timing.dropped
+    );
+}
+#endif // PLATFORM_AMIGA
+
+void dbgcons_service()
+{
+    static uint64_t last_print = 0;
+
+    // periodic statistics; at most once a second so the uart isn't flooded
+    if ((time_us_64() - last_print) < 1000000)
+        return;
+    last_print = time_us_64();
+
+    dbgcons_disp_stats();
+#ifdef PLATFORM_AMIGA
+    dbgcons_aqm_stats();
+    dbgcons_ready();
+    dbgcons_kbd_timing();
+#endif
+}
+
 void dbgcons_amiga_mod(uint8_t outcode, char updown)
 {
     // ls rs cl ct la ra lam ram
@@ -37,4 +37,14 @@ void dbgcons_unplug(enum debug_plug_types devtype);
 
 void dbgcons_amiga_key(uint8_t incode, uint8_t outcode, char *updown);
 
+void dbgcons_aqm_stats();
+
+void dbgcons_disp_stats();
+
+void dbgcons_ready();
+
+void dbgcons_kbd_timing();
+
+void dbgcons_service();
+
 #endif // _PLATFORM_COMMON_DEBUG_CONS_H
@@ -0,0 +1,265 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * keystroke injection over the uart.
+ *
+ * commands are lines of hex arguments. keyboard reports go through hid_keyboard_report(), the same path usb
+ * keyboards take, and raw codes straight into the machine's keyboard queue. the bulk commands switch to binary and are
+ * paced by the queue: nothing more is read from the uart until there's room for what's already been read, and the
+ * sender is kept within INJECT_WINDOW bytes of that by acks, so the uart fifo never overflows either.
+ *
+ * on the amiga, the same bulk transfer carries the steps of a keyboard macro, which is defined once the last one is
+ * in and can then be saved to flash; this is the only way to define one without rebuilding the firmware.
+ *
+ * replies go out with printf rather than ahprintf, as a script waits on them whether or not debug messages are
+ * on; each is a line starting "inj ", to pick out from the debug console around it.
+ */
+
+#ifdef INJECT_UART
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "inject.h"
+#include "platform/platform.h"
+#ifdef PLATFORM_AMIGA
+#  include "platform/amiga/keyboard_serial_io.h"
+#  include "platform/amiga/macro.h"
+#endif
+#include "usb_hid.h"
+
+#include "pico/stdlib.h"
+
+#define INJECT_LINE_MAX     64
+#define INJECT_REPORT_LEN   8   // boot protocol: modifier, reserved, six keycodes
+
+// a report can release six keys, press six and change all eight modifiers
+#define INJECT_REPORT_CODES 20
+
+static char line[INJECT_LINE_MAX];
+static uint8_t line_len = 0;
+
+// bulk transfer in progress: items left, and the one being read
+static uint32_t bulk_remaining = 0,
+                bulk_items = 0;
+static uint8_t bulk_size = 0,
+               bulk_fill = 0,
+               bulk_unacked = 0;
+static uint8_t bulk_item[INJECT_REPORT_LEN];
+
+#ifdef PLATFORM_AMIGA
+// macro being sent: its trigger, and the steps read so far (bulk_size is 2 whilst one is)
+static uint8_t macro_modifier = 0,
+               macro_keycode = 0;
+static uint16_t macro_steps[MACRO_POOL_STEPS];
+#endif
+
+static uint32_t injected = 0;
+
+/**
+ * Hand one item to the keyboard path
+ *
+ * @param item      Raw code (one byte, bit 7 for key up) or keyboard report
+ * @param size      1 or INJECT_REPORT_LEN
+ */
+static void _inject_item(const uint8_t *item, uint8_t size)
+{
+    if (size == 1) {
+        platform_key_raw(item[0] & 0x7f, item[0] & 0x80);
+    } else {
+        // each report is a poll of its own, and has to be in the queue before room for the next is judged
+        hid_keyboard_report(HID_VIRTUAL_DEV_ADDR, INJECT_INSTANCE, item, size);
+        platform_key_flush();
+    }
+
+    injected++;
+}
+
+/**
+ * Carry on with a bulk transfer
+ */
+static void _inject_bulk()
+{
+    int c;
+
+    while (bulk_remaining) {
+        if (bulk_fill == bulk_size) {
+#ifdef PLATFORM_AMIGA
+            if (bulk_size == 2) {
+                // a macro step, little endian; nothing is sent until the macro is played, so no waiting for room
+                macro_steps[bulk_items - bulk_remaining] = bulk_item[0] | (bulk_item[1] << 8);
+            } else
+#endif
+            {
+                // a whole item read; hold it (and the uart) until the queue can take everything it might produce
+                if (platform_key_room() < ((bulk_size == 1) ? 1 : INJECT_REPORT_CODES))
+                    return;
+
+                _inject_item(bulk_item, bulk_size);
+            }
+            bulk_fill = 0;
+            bulk_remaining--;
+
+            bulk_unacked += bulk_size;
+            if (bulk_unacked >= (INJECT_WINDOW / 2)) {
+                bulk_unacked -= INJECT_WINDOW / 2;
+                printf("inj +\n");
+            }
+            continue;
+        }
+
+        if ((c = getchar_timeout_us(0)) == PICO_ERROR_TIMEOUT)
+            return;
+        bulk_item[bulk_fill++] = c;
+    }
+
+#ifdef PLATFORM_AMIGA
+    if ((bulk_size == 2) && !amiga_macro_define(macro_modifier, macro_keycode, macro_steps, bulk_items)) {
+        printf("inj err\n");
+        return;
+    }
+#endif
+
+    printf("inj done %" PRIu32 "\n", bulk_items);
+}
+
+/**
+ * Act on a command line
+ */
+static void _inject_command()
+{
+    uint32_t arg[INJECT_REPORT_LEN];
+    uint8_t report[INJECT_REPORT_LEN] = { 0 };
+#ifdef PLATFORM_AMIGA
+    amiga_kbd_timing_t timing;
+#endif
+    char *pos = &line[1], *end;
+    uint8_t args = 0;
+
+    // hex arguments, separated by spaces
+    while (args < INJECT_REPORT_LEN) {
+        arg[args] = strtoul(pos, &end, 16);
+        if (end == pos)
+            break;
+        pos = end;
+        args++;
+    }
+
+    switch (line[0]) {
+        case 'k':
+            // k <modifier> [key ...]: a keyboard report; keys not given are released
+            if (!args || (args > 7))
+                break;
+            report[0] = arg[0];
+            for (uint8_t i = 1; i < args; i++)
+                report[i + 1] = arg[i];
+            _inject_item(report, INJECT_REPORT_LEN);
+            printf("inj ok\n");
+            return;
+
+        case 'a':
+            // a <code>: a raw keycode for the machine (amiga, st), bit 7 set for key up
+            if ((args != 1) || (arg[0] > 0xff))
+                break;
+            report[0] = arg[0];
+            _inject_item(report, 1);
+            printf("inj ok\n");
+            return;
+
+        case 'A':
+        case 'K':
+            // A <count> / K <count>: that many raw codes, or 8 byte reports, follow in binary
+            if ((args != 1) || !arg[0])
+                break;
+            bulk_remaining = bulk_items = arg[0];
+            bulk_size = (line[0] == 'A') ? 1 : INJECT_REPORT_LEN;
+            bulk_fill = 0;
+            bulk_unacked = 0;
+            printf("inj go\n");
+            return;
+
+#ifdef PLATFORM_AMIGA
+        case 'm':
+            // m <modifier> <key> <count>: a macro on that key, its steps following as 16 bit little endian binary
+            if ((args != 3) || (arg[0] > 0xff) || (arg[1] > 0xff) || !arg[2] || (arg[2] > MACRO_POOL_STEPS))
+                break;
+            macro_modifier = arg[0];
+            macro_keycode = arg[1];
+            bulk_remaining = bulk_items = arg[2];
+            bulk_size = 2;
+            bulk_fill = 0;
+            bulk_unacked = 0;
+            printf("inj go\n");
+            return;
+
+        case 'M':
+            // M: keep the macros defined so far over a power cycle
+            if (!amiga_macro_save()) {
+                printf("inj err\n");
+                return;
+            }
+            printf("inj ok\n");
+            return;
+
+        case 'c':
+            // c: forget them; saved ones are only gone once an M follows
+            amiga_macro_clear();
+            printf("inj ok\n");
+            return;
+#endif
+
+        case 's':
+#ifdef PLATFORM_AMIGA
+            amiga_kbd_timing(&timing);
+            printf(
+                "inj stats injected %" PRIu32 " acks %" PRIu32 " missed %" PRIu32 " dropped %" PRIu32 " ack_us %" PRIu32
+                " resets %" PRIu32 "\n",
+                injected, timing.acks, timing.missed_acks, timing.dropped, timing.ack_estimate_us,
+                amiga_host_resets()
+            );
+#else
+            printf("inj stats injected %" PRIu32 "\n", injected);
+#endif
+            return;
+    }
+
+    printf("inj err\n");
+}
+
+void inject_service()
+{
+    int c;
+
+    if (bulk_remaining) {
+        _inject_bulk();
+        return;
+    }
+
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if ((c == '\r') || (c == '\n')) {
+            if (line_len) {
+                line[line_len] = '\0';
+                line_len = 0;
+                _inject_command();
+
+                // anything after a bulk command is its data
+                if (bulk_remaining)
+                    return;
+            }
+            continue;
+        }
+
+        // overlong lines are cut short, and fail to parse
+        if (line_len < (INJECT_LINE_MAX - 1))
+            line[line_len++] = c;
+    }
+}
+
+#endif // INJECT_UART
@@ -0,0 +1,26 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * keystroke injection over the uart, for driving the keyboard line from a script. only built in when INJECT_UART
+ * is defined; see doc/installation.md for the command set.
+ */
+
+#ifndef _UTIL_INJECT_H
+#define _UTIL_INJECT_H
+
+// injected keyboard reports arrive as this instance on HID_VIRTUAL_DEV_ADDR
+#define INJECT_INSTANCE     1
+
+// in bulk mode the sender may have this many bytes unacknowledged; an ack goes back for each half of it
+#define INJECT_WINDOW       32
+
+/**
+ * @brief Read and act on whatever has arrived on the uart; never waits. Call regularly from the main loop.
+ */
+void inject_service();
+
+#endif // _UTIL_INJECT_H
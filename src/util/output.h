@@ -20,4 +20,15 @@ void ahprintf(const char *fmt, ...);
 void ahfprintf(FILE *stream, const char *fmt, ...);
 void ahvfprintf(FILE *stream, const char *fmt, va_list args);
 
+/**
+ * keyboard trace: one line per hid keyboard report in ("trace hid ...") and per code put on the wire
+ * ("trace ami ..."), with no cursor positioning, so a uart capture can be grepped for "trace " and diffed against
+ * a known-good capture of the same input. compiled out unless TRACE_KEYBOARD is defined.
+ */
+#ifdef TRACE_KEYBOARD
+#  define ahtrace(...) ahprintf(__VA_ARGS__)
+#else
+#  define ahtrace(...)
+#endif
+
 #endif
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#
+# this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+# please locate the full source at https://github.com/borb/amigahid-pico
+#
+# released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+# please find the complete license text at https://spdx.org/licenses/EPL-2.0
+#
+# writes the hid_fuzz seed corpus (see ../hid_fuzz.c for the layout of an input). the descriptors are typed in from
+# the hid 1.11 specification and from published dumps of the devices named, not captured here; the reports after each
+# are made up to exercise the fields the descriptor declares.
+#
+#   python3 make_corpus.py corpus
+
+import os
+import sys
+
+PROTOCOL_NONE, PROTOCOL_KEYBOARD, PROTOCOL_MOUSE = 0, 1, 2
+
+SEEDS = {
+    # hid 1.11 appendix e.6, the boot keyboard
+    'boot_keyboard': (PROTOCOL_KEYBOARD, '''
+        05 01 09 06 a1 01 05 07 19 e0 29 e7 15 00 25 01 75 01 95 08 81 02 95 01 75 08 81 01 95 05 75 01 05 08 19 01
+        29 05 91 02 95 01 75 03 91 01 95 06 75 08 15 00 25 65 05 07 19 00 29 65 81 00 c0
+    ''', [
+        '00 00 04 00 00 00 00 00',
+        '02 00 04 05 00 00 00 00',
+        '00 00 39 00 00 00 00 00',
+        '00 00 00 00 00 00 00 00',
+        '00 00 01 01 01 01 01 01',
+    ]),
+    # a keyboard with its media keys in a consumer collection alongside, on report ids 1 and 2
+    'keyboard_consumer': (PROTOCOL_NONE, '''
+        05 01 09 06 a1 01 85 01 05 07 19 e0 29 e7 15 00 25 01 75 01 95 08 81 02 95 01 75 08 81 01 95 06 75 08 15 00
+        25 65 05 07 19 00 29 65 81 00 c0 05 0c 09 01 a1 01 85 02 15 00 26 3c 02 19 00 2a 3c 02 75 10 95 01 81 00 c0
+    ''', [
+        '01 00 00 04 00 00 00 00 00',
+        '01 00 00 00 00 00 00 00 00',
+        '02 e9 00',
+        '02 00 00',
+        '03 ff',
+    ]),
+    # the generic three button wheel mouse most mice describe themselves as
+    'wheel_mouse': (PROTOCOL_MOUSE, '''
+        05 01 09 02 a1 01 09 01 a1 00 05 09 19 01 29 03 15 00 25 01 95 03 75 01 81 02 95 01 75 05 81 03 05 01 09 30
+        09 31 09 38 15 81 25 7f 75 08 95 03 81 06 c0 c0
+    ''', [
+        '01 05 fb 00',
+        '00 00 00 01',
+        '00 00 00 ff',
+        '07 80 7f 80',
+        '00',
+    ]),
+    # logitech unifying receiver, mouse interface: report id 2, sixteen buttons, 12 bit x and y, wheel and ac pan
+    'unifying_mouse': (PROTOCOL_MOUSE, '''
+        05 01 09 02 a1 01 85 02 09 01 a1 00 05 09 19 01 29 10 15 00 25 01 95 10 75 01 81 02 05 01 16 01 f8 26 ff 07
+        75 0c 95 02 09 30 09 31 81 06 15 81 25 7f 75 08 95 01 09 38 81 06 05 0c 0a 38 02 95 01 81 06 c0 c0
+    ''', [
+        '02 01 00 05 f0 ff 00 00',
+        '02 00 00 01 f8 7f 01 00',
+        '02 00 00 00 00 00 00 ff',
+        '02 00 00 00 00 00 00 01',
+        '03 00 00 00',
+    ]),
+    # dragonrise generic usb pad (0079:0006), as sold in a great many snes style pads
+    'dragonrise_pad': (PROTOCOL_NONE, '''
+        05 01 09 04 a1 01 a1 02 75 08 95 05 15 00 26 ff 00 35 00 46 ff 00 09 30 09 31 09 32 09 32 09 35 81 02 75 04
+        95 01 25 07 46 3b 01 65 14 09 39 81 42 65 00 75 01 95 0c 25 01 45 01 05 09 19 01 29 0c 81 02 06 00 ff 75 01
+        95 08 25 01 45 01 09 01 81 02 c0 a1 02 75 08 95 07 46 ff 00 26 ff 00 09 02 91 02 c0 c0
+    ''', [
+        '7f 7f 7f 7f 7f 0f 00 00',
+        '00 7f 7f 7f 7f 2f 00 00',
+        'ff ff 7f 7f 7f 0f 0f 00',
+        '7f 7f 7f 7f 7f 00 00 00',
+        '7f 7f',
+    ]),
+}
+
+
+def seed(protocol, desc, reports):
+    desc = bytes.fromhex(desc)
+    data = bytes([protocol, len(desc) & 0xff, len(desc) >> 8]) + desc
+    for report in reports:
+        report = bytes.fromhex(report)
+        data += bytes([len(report)]) + report
+    return data
+
+
+if __name__ == '__main__':
+    out = sys.argv[1] if len(sys.argv) > 1 else 'corpus'
+    os.makedirs(out, exist_ok=True)
+    for name, (protocol, desc, reports) in SEEDS.items():
+        with open(os.path.join(out, name), 'wb') as f:
+            f.write(seed(protocol, desc, reports))
@@ -0,0 +1,165 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * usb hid fuzzing: a report descriptor and the reports that follow it are what a usb device gets to say to the
+ * firmware, and the firmware has to survive anything said. each input mounts an interface with the descriptor through
+ * tuh_hid_mount_cb(), hands it the reports through tuh_hid_report_received_cb(), and unplugs it.
+ *
+ * an input is laid out as
+ *
+ *   byte 0         interface protocol, modulo 3 (none, keyboard, mouse)
+ *   bytes 1-2      descriptor length, little endian; cut short at the end of the input
+ *   ...            descriptor
+ *   then, repeated: a length byte and a report of that length (again cut short at the end)
+ *
+ * built with AMIGAHID_FUZZ (clang only) this is a libfuzzer target; otherwise main() below replays files, or
+ * directories of them, as ctest does with the seed corpus in fuzz/corpus.
+ */
+
+#include "host_sdk.h"
+#include "platform/platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "tusb.h"
+
+// the interface every input is mounted as
+#define FUZZ_DEV            1
+#define FUZZ_INSTANCE       0
+
+// longest report handed over; tinyusb's buffer (CFG_TUH_HID_EPIN_BUFSIZE) is no bigger
+#define FUZZ_REPORT_MAX     64
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool ready = false;
+    uint8_t report[FUZZ_REPORT_MAX];
+    uint16_t desc_len;
+    uint8_t len;
+
+    if (!ready) {
+        // the firmware's debug output is no use here, and slows every input down
+        if (freopen("/dev/null", "w", stdout) == NULL)
+            abort();
+        host_init();
+        platform_init();
+        ready = true;
+    }
+
+    if (size < 3)
+        return 0;
+
+    desc_len = data[1] | (data[2] << 8);
+    if (desc_len > (size - 3))
+        desc_len = size - 3;
+
+    // a copy each, so reading past either is caught rather than landing in the rest of the input
+    uint8_t *desc = malloc(desc_len ? desc_len : 1);
+    memcpy(desc, data + 3, desc_len);
+    host_mount(FUZZ_DEV, FUZZ_INSTANCE, data[0] % 3, desc_len ? desc : NULL, desc_len);
+
+    data += 3 + desc_len;
+    size -= 3 + desc_len;
+
+    while (size) {
+        len = data[0];
+        if (len > (size - 1))
+            len = size - 1;
+        if (len > FUZZ_REPORT_MAX)
+            len = FUZZ_REPORT_MAX;
+
+        memcpy(report, data + 1, len);
+        tuh_hid_report_received_cb(FUZZ_DEV, FUZZ_INSTANCE, report, len);
+        platform_service();
+        host_advance_us(1000);
+
+        data += 1 + len;
+        size -= 1 + len;
+    }
+
+    host_umount(FUZZ_DEV, FUZZ_INSTANCE);
+    platform_service();
+    free(desc);
+
+    return 0;
+}
+
+#ifndef AMIGAHID_FUZZ
+
+/**
+ * Run one input file through the target
+ *
+ * @param path      File
+ * @return true     Ran
+ * @return false    Couldn't read it
+ */
+static bool _fuzz_file(const char *path)
+{
+    uint8_t *data;
+    long size;
+    FILE *input;
+
+    if ((input = fopen(path, "rb")) == NULL)
+        return false;
+
+    fseek(input, 0, SEEK_END);
+    size = ftell(input);
+    rewind(input);
+
+    data = malloc(size ? size : 1);
+    if (fread(data, 1, size, input) != (size_t)size) {
+        free(data);
+        fclose(input);
+        return false;
+    }
+    fclose(input);
+
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    char path[1024];
+    struct dirent *entry;
+    DIR *dir;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: hid_fuzz <input or directory>...\n");
+        return 2;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if ((dir = opendir(argv[i])) == NULL) {
+            if (!_fuzz_file(argv[i])) {
+                fprintf(stderr, "%s: can't read it\n", argv[i]);
+                return 2;
+            }
+            continue;
+        }
+
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.')
+                continue;
+            snprintf(path, sizeof(path), "%s/%s", argv[i], entry->d_name);
+            if (!_fuzz_file(path)) {
+                fprintf(stderr, "%s: can't read it\n", path);
+                return 2;
+            }
+        }
+        closedir(dir);
+    }
+
+    return 0;
+}
+
+#endif // AMIGAHID_FUZZ
@@ -0,0 +1,156 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: the amiga's side of the mouse ports.
+ *
+ * every edge the firmware makes on a port's lines is fed, as it happens, through the decoding the amiga's joyxdat
+ * counters do: the two lines of an axis form a gray code, (h, hq) = (1,0), (1,1), (0,1), (0,0) being successive counts,
+ * so one line changing is a step and both at once is something the amiga can't resolve. host_mouse_check() then holds
+ * what the counters saw up against what the firmware says it stepped out. the firmware used to do this itself on
+ * core1, reading each line back after setting it; here it costs the firmware nothing.
+ */
+
+#include "host_sdk.h"
+#include "config.h"
+#include "platform/amiga/quad_mouse.h"
+
+#include <stdio.h>
+
+#include "pico/time.h"
+
+// the steps an axis remembers, to see how far it moved in the last frame: one more than a frame may carry
+#define HOST_MOUSE_STEPS    (AQM_FRAME_COUNTS + 1)
+
+// one axis's counter
+typedef struct {
+    uint main_pin, quad_pin;    // h and hq, or v and vq
+    bool main, quad;            // levels last seen; the lines idle high
+    int32_t position;           // where the counter has got to, without the 8 bit wrap
+    uint32_t counts;            // steps it's taken, either way
+    uint32_t glitches;          // edges it couldn't take as one step
+    uint32_t overruns;          // steps which put it more than a signed byte from where it was a frame before
+    uint64_t step_at[HOST_MOUSE_STEPS];
+    int8_t step_dir[HOST_MOUSE_STEPS];
+    uint8_t step_pos;
+} host_axis_t;
+
+typedef struct {
+    host_axis_t axes[2];
+    uint button_pins[3];        // left, middle, right
+} host_port_t;
+
+#define HOST_PORT(h, hq, v, vq, left, middle, right) \
+    { \
+        .axes = { \
+            { .main_pin = (h), .quad_pin = (hq), .main = true, .quad = true }, \
+            { .main_pin = (v), .quad_pin = (vq), .main = true, .quad = true }, \
+        }, \
+        .button_pins = { (left), (middle), (right) }, \
+    }
+
+static host_port_t host_ports[AQM_PORTS] = {
+    HOST_PORT(QM1_AMIGA_H, QM1_AMIGA_HQ, QM1_AMIGA_V, QM1_AMIGA_VQ, QM1_AMIGA_B1, QM1_AMIGA_B3, QM1_AMIGA_B2),
+#ifdef HAS_PORT2
+    HOST_PORT(QM2_AMIGA_H, QM2_AMIGA_HQ, QM2_AMIGA_V, QM2_AMIGA_VQ, QM2_AMIGA_B1, QM2_AMIGA_B3, QM2_AMIGA_B2),
+#endif
+};
+
+/**
+ * Take an edge on one of an axis's lines
+ *
+ * @param axis      Axis
+ * @param main      Level on the h/v line now
+ * @param quad      Level on the hq/vq line now
+ */
+static void _mouse_step(host_axis_t *axis, bool main, bool quad)
+{
+    static const uint8_t gray[2][2] = { { 3, 2 }, { 0, 1 } }; // indexed [main][quad]
+    uint8_t step = (gray[main][quad] - gray[axis->main][axis->quad]) & 3;
+    uint64_t now = time_us_64();
+    int32_t frame = 0;
+
+    axis->main = main;
+    axis->quad = quad;
+
+    if ((step != 1) && (step != 3)) {
+        axis->glitches++;
+        return;
+    }
+
+    axis->position += (step == 1) ? 1 : -1;
+    axis->counts++;
+    axis->step_at[axis->step_pos] = now;
+    axis->step_dir[axis->step_pos] = (step == 1) ? 1 : -1;
+    axis->step_pos = (axis->step_pos + 1) % HOST_MOUSE_STEPS;
+
+    // the amiga samples the counter once a frame and takes the difference as signed 8 bit; its frames could fall
+    // anywhere, so any frame's worth of steps ending here has to fit
+    for (uint8_t i = 0; i < HOST_MOUSE_STEPS; i++) {
+        if (axis->step_dir[i] && ((now - axis->step_at[i]) < AQM_FRAME_US))
+            frame += axis->step_dir[i];
+    }
+    if ((frame > 127) || (frame < -128))
+        axis->overruns++;
+}
+
+void host_mouse_edge(uint gpio, bool level)
+{
+    static const char *names[3] = { "left", "middle", "right" };
+    host_axis_t *axis;
+
+    for (uint8_t port = 0; port < AQM_PORTS; port++) {
+        for (uint8_t i = 0; i < 2; i++) {
+            axis = &host_ports[port].axes[i];
+            if (gpio == axis->main_pin)
+                _mouse_step(axis, level, axis->quad);
+            else if (gpio == axis->quad_pin)
+                _mouse_step(axis, axis->main, level);
+        }
+
+        for (uint8_t i = 0; i < 3; i++) {
+            if (gpio == host_ports[port].button_pins[i])
+                printf("trace button %u %s %c\n", port, names[i], level ? 'u' : 'd');
+        }
+    }
+}
+
+bool host_mouse_check(void)
+{
+    amiga_quad_mouse_stats_t stats;
+    host_axis_t *axes;
+    bool good = true;
+
+    for (uint8_t port = 0; port < AQM_PORTS; port++) {
+        amiga_quad_mouse_stats(port, &stats);
+        axes = host_ports[port].axes;
+        if (!stats.requested[0] && !stats.requested[1] && !axes[0].counts && !axes[1].counts && !axes[0].glitches
+            && !axes[1].glitches)
+            continue;
+
+        printf(
+            "trace mouse %u x %ld y %ld lost %lu %lu\n",
+            port, (long)axes[0].position, (long)axes[1].position,
+            (unsigned long)stats.lost[0], (unsigned long)stats.lost[1]
+        );
+
+        for (uint8_t i = 0; i < 2; i++) {
+            if ((axes[i].counts == stats.sent[i]) && (stats.sent[i] == (stats.requested[i] - stats.lost[i]))
+                && !axes[i].glitches && !axes[i].overruns)
+                continue;
+
+            fprintf(
+                stderr, "port %u %c: %lu requested, %lu lost, %lu sent, %lu counted, %lu glitches, %lu overruns\n",
+                port, i ? 'y' : 'x',
+                (unsigned long)stats.requested[i], (unsigned long)stats.lost[i], (unsigned long)stats.sent[i],
+                (unsigned long)axes[i].counts, (unsigned long)axes[i].glitches, (unsigned long)axes[i].overruns
+            );
+            good = false;
+        }
+    }
+
+    return good;
+}
@@ -0,0 +1,14 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: tinyusb's bsp/board.h. only included.
+ */
+
+#ifndef _HOST_BSP_BOARD_H
+#define _HOST_BSP_BOARD_H
+
+#endif // _HOST_BSP_BOARD_H
@@ -0,0 +1,104 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: the parts of tinyusb's class/hid/hid.h the firmware uses, with the same values.
+ */
+
+#ifndef _HOST_CLASS_HID_HID_H
+#define _HOST_CLASS_HID_HID_H
+
+#include <stdint.h>
+
+typedef struct __attribute__((packed)) {
+    uint8_t modifier;
+    uint8_t reserved;
+    uint8_t keycode[6];
+} hid_keyboard_report_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t buttons;
+    int8_t x;
+    int8_t y;
+    int8_t wheel;
+    int8_t pan;
+} hid_mouse_report_t;
+
+typedef enum {
+    KEYBOARD_MODIFIER_LEFTCTRL   = 1 << 0,
+    KEYBOARD_MODIFIER_LEFTSHIFT  = 1 << 1,
+    KEYBOARD_MODIFIER_LEFTALT    = 1 << 2,
+    KEYBOARD_MODIFIER_LEFTGUI    = 1 << 3,
+    KEYBOARD_MODIFIER_RIGHTCTRL  = 1 << 4,
+    KEYBOARD_MODIFIER_RIGHTSHIFT = 1 << 5,
+    KEYBOARD_MODIFIER_RIGHTALT   = 1 << 6,
+    KEYBOARD_MODIFIER_RIGHTGUI   = 1 << 7,
+} hid_keyboard_modifier_bm_t;
+
+typedef enum {
+    KEYBOARD_LED_NUMLOCK    = 1 << 0,
+    KEYBOARD_LED_CAPSLOCK   = 1 << 1,
+    KEYBOARD_LED_SCROLLLOCK = 1 << 2,
+} hid_keyboard_led_bm_t;
+
+typedef enum {
+    MOUSE_BUTTON_LEFT   = 1 << 0,
+    MOUSE_BUTTON_RIGHT  = 1 << 1,
+    MOUSE_BUTTON_MIDDLE = 1 << 2,
+} hid_mouse_button_bm_t;
+
+typedef enum {
+    HID_ITF_PROTOCOL_NONE     = 0,
+    HID_ITF_PROTOCOL_KEYBOARD = 1,
+    HID_ITF_PROTOCOL_MOUSE    = 2,
+} hid_interface_protocol_enum_t;
+
+enum {
+    HID_PROTOCOL_BOOT   = 0,
+    HID_PROTOCOL_REPORT = 1,
+};
+
+typedef enum {
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE,
+} hid_report_type_t;
+
+enum {
+    HID_COLLECTION_PHYSICAL    = 0,
+    HID_COLLECTION_APPLICATION = 1,
+    HID_COLLECTION_LOGICAL     = 2,
+};
+
+enum {
+    HID_USAGE_PAGE_DESKTOP  = 0x01,
+    HID_USAGE_PAGE_KEYBOARD = 0x07,
+    HID_USAGE_PAGE_BUTTON   = 0x09,
+    HID_USAGE_PAGE_CONSUMER = 0x0c,
+};
+
+enum {
+    HID_USAGE_DESKTOP_POINTER    = 0x01,
+    HID_USAGE_DESKTOP_MOUSE      = 0x02,
+    HID_USAGE_DESKTOP_JOYSTICK   = 0x04,
+    HID_USAGE_DESKTOP_GAMEPAD    = 0x05,
+    HID_USAGE_DESKTOP_KEYBOARD   = 0x06,
+    HID_USAGE_DESKTOP_X          = 0x30,
+    HID_USAGE_DESKTOP_Y          = 0x31,
+    HID_USAGE_DESKTOP_WHEEL      = 0x38,
+    HID_USAGE_DESKTOP_HAT_SWITCH = 0x39,
+};
+
+enum {
+    HID_USAGE_CONSUMER_AC_PAN    = 0x0238,
+};
+
+#define HID_KEY_NONE            0x00
+#define HID_KEY_F12             0x45
+#define HID_KEY_APPLICATION     0x65
+
+#endif // _HOST_CLASS_HID_HID_H
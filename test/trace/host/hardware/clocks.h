@@ -0,0 +1,21 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/clocks.h
+ */
+
+#ifndef _HOST_HARDWARE_CLOCKS_H
+#define _HOST_HARDWARE_CLOCKS_H
+
+#include "pico.h"
+
+#define CLOCKS_FC0_SRC_VALUE_CLK_SYS    0x09
+
+// the pico's default system clock
+static inline uint32_t frequency_count_khz(uint src) { return 125000; }
+
+#endif // _HOST_HARDWARE_CLOCKS_H
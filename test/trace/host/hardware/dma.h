@@ -0,0 +1,43 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/dma.h. only a transfer into an i2c controller's data_cmd register goes anywhere (see i2c.c).
+ */
+
+#ifndef _HOST_HARDWARE_DMA_H
+#define _HOST_HARDWARE_DMA_H
+
+#include "pico.h"
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    bool read_increment, write_increment;
+    enum dma_channel_transfer_size size;
+    uint dreq;
+} dma_channel_config;
+
+static inline dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    return (dma_channel_config){ .read_increment = true, .size = DMA_SIZE_32 };
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_increment = incr; }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_increment = incr; }
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) { c->dreq = dreq; }
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+    const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_abort(uint channel);
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+
+#endif // _HOST_HARDWARE_DMA_H
@@ -0,0 +1,26 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/flash.h. flash is an array, erased at startup.
+ */
+
+#ifndef _HOST_HARDWARE_FLASH_H
+#define _HOST_HARDWARE_FLASH_H
+
+#include "pico.h"
+
+#define FLASH_PAGE_SIZE         (1u << 8)
+#define FLASH_SECTOR_SIZE       (1u << 12)
+#define PICO_FLASH_SIZE_BYTES   (2 * 1024 * 1024)
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE                ((uintptr_t)host_flash)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif // _HOST_HARDWARE_FLASH_H
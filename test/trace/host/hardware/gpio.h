@@ -0,0 +1,34 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/gpio.h. pins are modelled as open drain lines with the amiga's pull-ups on them.
+ */
+
+#ifndef _HOST_HARDWARE_GPIO_H
+#define _HOST_HARDWARE_GPIO_H
+
+#include "pico.h"
+
+enum gpio_function { GPIO_FUNC_I2C = 3, GPIO_FUNC_SIO = 5 };
+
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+enum gpio_irq_level { GPIO_IRQ_LEVEL_LOW = 0x1u, GPIO_IRQ_LEVEL_HIGH = 0x2u, GPIO_IRQ_EDGE_FALL = 0x4u, GPIO_IRQ_EDGE_RISE = 0x8u };
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t events);
+
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+void gpio_pull_up(uint gpio);
+bool gpio_get(uint gpio);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+
+#endif // _HOST_HARDWARE_GPIO_H
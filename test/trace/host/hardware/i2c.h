@@ -0,0 +1,46 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/i2c.h. the controller's registers are plain memory; the transfer the dma feeds them is taken
+ * off the bus in i2c.c.
+ */
+
+#ifndef _HOST_HARDWARE_I2C_H
+#define _HOST_HARDWARE_I2C_H
+
+#include "pico.h"
+
+#define I2C_IC_DATA_CMD_RESTART_BITS        0x00000400u
+#define I2C_IC_DATA_CMD_STOP_BITS           0x00000200u
+#define I2C_IC_DATA_CMD_CMD_BITS            0x00000100u
+
+#define I2C_IC_INTR_STAT_R_STOP_DET_BITS    0x00000200u
+#define I2C_IC_INTR_STAT_R_TX_ABRT_BITS     0x00000040u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS    0x00000200u
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS     0x00000040u
+
+typedef struct {
+    volatile uint32_t enable, tar, data_cmd, intr_stat, intr_mask, clr_tx_abrt, clr_stop_det;
+} i2c_hw_t;
+
+typedef struct {
+    i2c_hw_t hw;
+    uint baudrate;
+} i2c_inst_t;
+
+extern i2c_inst_t host_i2c[2];
+
+#define i2c0 (&host_i2c[0])
+#define i2c1 (&host_i2c[1])
+
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) { return &i2c->hw; }
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) { return (is_tx ? 0 : 1) + ((i2c == i2c1) ? 2 : 0); }
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+
+#endif // _HOST_HARDWARE_I2C_H
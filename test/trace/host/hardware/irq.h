@@ -0,0 +1,24 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/irq.h. the display's i2c interrupt is the only one raised (see i2c.c).
+ */
+
+#ifndef _HOST_HARDWARE_IRQ_H
+#define _HOST_HARDWARE_IRQ_H
+
+#include "pico.h"
+
+#define I2C0_IRQ    23
+#define I2C1_IRQ    24
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+#endif // _HOST_HARDWARE_IRQ_H
@@ -0,0 +1,16 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/pio.h. only included; the passthrough which uses it isn't built here.
+ */
+
+#ifndef _HOST_HARDWARE_PIO_H
+#define _HOST_HARDWARE_PIO_H
+
+#include "pico.h"
+
+#endif // _HOST_HARDWARE_PIO_H
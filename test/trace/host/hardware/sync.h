@@ -0,0 +1,19 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: hardware/sync.h. nothing interrupts the replay, so there's nothing to disable.
+ */
+
+#ifndef _HOST_HARDWARE_SYNC_H
+#define _HOST_HARDWARE_SYNC_H
+
+#include "pico.h"
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+#endif // _HOST_HARDWARE_SYNC_H
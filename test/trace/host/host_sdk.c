@@ -0,0 +1,471 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: what the keyboard path needs from the pico sdk, tinyusb and the rest of the firmware, so it can be
+ * replayed on a pc.
+ *
+ * time only moves when host_advance_us() is called, and the transmitter's alarm fires as it passes. the amiga is
+ * modelled on the keyboard lines: it shifts in a bit on /dat as /clk rises and handshakes every eighth on /dat, the
+ * same as the machine does, so power-up, pacing and reset warnings run their real course. each byte it takes in is
+ * printed as "trace rx", so what actually went down the wire is compared as well as what was queued.
+ */
+
+#include "host_sdk.h"
+#include "config.h"
+#include "util/debug_cons.h"
+#include "platform/amiga/quad_mouse.h"
+#include "platform/amiga/joystick.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "tusb.h"
+
+// when the amiga starts its handshake after the eighth bit, and how long it holds /dat low
+#define AMIGA_HANDSHAKE_DELAY_US    100
+#define AMIGA_HANDSHAKE_US          85
+
+// how long after /rst goes high before the amiga is listening; edges on /clk before then go unseen
+#define AMIGA_BOOT_US               1000
+
+#define HOST_INTERFACES             16
+#define HOST_EVENTS                 8
+
+// how often core1's loop gets a pass as time moves on; well inside the quickest the mouse lines may change
+#define HOST_CORE1_US               10
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+static uint64_t now_us = 1000;
+
+// host_advance_us() is running: a busy wait is in an alarm or core1, and just lets the time go by
+static bool advancing = false;
+
+// core1 (the mouse ports), once launched: when its loop next gets a pass
+static bool core1_launched = false;
+static uint64_t core1_at = 0;
+
+// the one alarm the firmware uses, the keyboard transmitter's
+static alarm_callback_t alarm_callback = NULL;
+static uint64_t alarm_at = 0;
+
+// pins: the level we'd drive if set to output, whether we are, and the amiga holding /dat low
+static bool pin_value[32], pin_output[32];
+static bool amiga_dat_low = false;
+static uint8_t amiga_bits = 0, amiga_shift = 0;
+static uint64_t amiga_booted = 0;
+static gpio_irq_callback_t irq_callback = NULL;
+
+// edges the amiga will make on /dat, in time order
+static struct {
+    uint64_t at;
+    uint32_t events;
+} amiga_events[HOST_EVENTS];
+static uint8_t amiga_event_count = 0;
+
+// the interface protocol each mounted usb interface has, and whether it's in boot or report protocol
+static struct {
+    bool in_use;
+    uint8_t dev_addr, instance, protocol, hid_protocol;
+} interfaces[HOST_INTERFACES];
+
+/**
+ * Find a mounted usb interface
+ *
+ * @param dev_addr  Device address
+ * @param instance  Interface instance
+ * @return int      Index into interfaces[], -1 if it isn't mounted
+ */
+static int _interface(uint8_t dev_addr, uint8_t instance)
+{
+    for (int i = 0; i < HOST_INTERFACES; i++) {
+        if (interfaces[i].in_use && (interfaces[i].dev_addr == dev_addr) && (interfaces[i].instance == instance))
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Queue an edge the amiga will make on /dat
+ *
+ * @param at        When
+ * @param events    GPIO_IRQ_EDGE_FALL or GPIO_IRQ_EDGE_RISE
+ */
+static void _amiga_event(uint64_t at, uint32_t events)
+{
+    if (amiga_event_count < HOST_EVENTS)
+        amiga_events[amiga_event_count++] = (typeof(amiga_events[0])){ at, events };
+}
+
+/**
+ * Level on a line: low if we or the amiga pull it down, otherwise the pull-up has it high
+ *
+ * @param gpio      Pin
+ * @return true     High
+ * @return false    Low
+ */
+static bool _line(uint gpio)
+{
+    if ((gpio == KBD_AMIGA_DAT) && amiga_dat_low)
+        return false;
+
+    return !(pin_output[gpio] && !pin_value[gpio]);
+}
+
+/**
+ * A line we drive has changed; the amiga clocks in /dat as /clk rises, and handshakes once it has a whole code
+ *
+ * @param gpio      Pin
+ * @param was       Level before
+ */
+static void _amiga_watch(uint gpio, bool was)
+{
+    bool level = _line(gpio);
+
+    if (level != was)
+        host_mouse_edge(gpio, level);
+
+    if ((gpio == KBD_AMIGA_RST) && !level) {
+        // it's being reset; whatever it had shifted in is gone
+        amiga_bits = 0;
+        amiga_shift = 0;
+        return;
+    }
+
+    if ((gpio == KBD_AMIGA_RST) && !was)
+        amiga_booted = now_us + AMIGA_BOOT_US;
+
+    if ((gpio != KBD_AMIGA_CLK) || was || !level || !_line(KBD_AMIGA_RST) || (now_us < amiga_booted))
+        return;
+
+    // /dat is active low, and the cia shifts it in msb first
+    amiga_shift = (amiga_shift << 1) | !_line(KBD_AMIGA_DAT);
+    if (++amiga_bits == 8) {
+        printf("trace rx %02x\n", amiga_shift);
+        amiga_bits = 0;
+        amiga_shift = 0;
+        _amiga_event(now_us + AMIGA_HANDSHAKE_DELAY_US, GPIO_IRQ_EDGE_FALL);
+        _amiga_event(now_us + AMIGA_HANDSHAKE_DELAY_US + AMIGA_HANDSHAKE_US, GPIO_IRQ_EDGE_RISE);
+    }
+}
+
+void host_advance_us(uint64_t us)
+{
+    uint64_t until = now_us + us, i2c_at;
+    int64_t next;
+    uint32_t events;
+
+    advancing = true;
+    for (;;) {
+        // the display's i2c transfer finishing, if that's before anything else
+        i2c_at = host_i2c_next();
+        if ((i2c_at <= until) && (!core1_launched || (i2c_at < core1_at))
+            && (!amiga_event_count || (i2c_at < amiga_events[0].at)) && (!alarm_callback || (i2c_at < alarm_at))) {
+            now_us = i2c_at;
+            host_i2c_finish();
+            continue;
+        }
+
+        // core1 runs in between everything else
+        if (core1_launched && (core1_at <= until) && (!amiga_event_count || (core1_at < amiga_events[0].at))
+            && (!alarm_callback || (core1_at < alarm_at))) {
+            now_us = core1_at;
+            core1_at += HOST_CORE1_US;
+            amiga_quad_mouse_service();
+            continue;
+        }
+
+        // whichever comes first: the amiga's next edge or the alarm
+        if (amiga_event_count && (amiga_events[0].at <= until)
+            && (!alarm_callback || (amiga_events[0].at <= alarm_at))) {
+            now_us = amiga_events[0].at;
+            events = amiga_events[0].events;
+            memmove(&amiga_events[0], &amiga_events[1], --amiga_event_count * sizeof(amiga_events[0]));
+
+            amiga_dat_low = (events == GPIO_IRQ_EDGE_FALL);
+            if (irq_callback)
+                irq_callback(KBD_AMIGA_DAT, events);
+            continue;
+        }
+
+        if (alarm_callback && (alarm_at <= until)) {
+            alarm_callback_t callback = alarm_callback;
+
+            now_us = alarm_at;
+            alarm_callback = NULL;
+            next = callback(1, NULL);
+
+            // negative: that long from now. positive would be from when it was due, which the firmware never asks
+            if (next && !alarm_callback) {
+                alarm_callback = callback;
+                alarm_at = now_us + ((next < 0) ? -next : next);
+            }
+            continue;
+        }
+
+        break;
+    }
+
+    now_us = until;
+    advancing = false;
+}
+
+void host_mount(uint8_t dev_addr, uint8_t instance, uint8_t protocol, uint8_t const *desc, uint16_t desc_len)
+{
+    for (uint8_t i = 0; i < HOST_INTERFACES; i++) {
+        if (!interfaces[i].in_use) {
+            interfaces[i].in_use = true;
+            interfaces[i].dev_addr = dev_addr;
+            interfaces[i].instance = instance;
+            interfaces[i].protocol = protocol;
+            // tinyusb puts an interface with a boot protocol into it at enumeration
+            interfaces[i].hid_protocol = (protocol == HID_ITF_PROTOCOL_NONE) ? HID_PROTOCOL_REPORT : HID_PROTOCOL_BOOT;
+            break;
+        }
+    }
+
+    tuh_hid_mount_cb(dev_addr, instance, desc, desc_len);
+}
+
+void host_umount(uint8_t dev_addr, uint8_t instance)
+{
+    int i;
+
+    tuh_hid_umount_cb(dev_addr, instance);
+
+    if ((i = _interface(dev_addr, instance)) >= 0)
+        interfaces[i].in_use = false;
+}
+
+void host_init(void)
+{
+    memset(host_flash, 0xff, sizeof(host_flash));
+}
+
+// pico sdk
+
+uint64_t time_us_64(void)
+{
+    return now_us;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)now_us;
+}
+
+void tight_loop_contents(void)
+{
+    // in the main loop, the alarm and everything else carries on around a busy wait
+    if (advancing)
+        now_us++;
+    else
+        host_advance_us(1);
+}
+
+void panic(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    abort();
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    alarm_callback = callback;
+    alarm_at = now_us + us;
+
+    return 1;
+}
+
+void gpio_init(uint gpio)
+{
+    pin_value[gpio] = false;
+    pin_output[gpio] = false;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    bool was = _line(gpio);
+
+    pin_output[gpio] = out;
+    _amiga_watch(gpio, was);
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    bool was = _line(gpio);
+
+    pin_value[gpio] = value;
+    _amiga_watch(gpio, was);
+}
+
+bool gpio_get(uint gpio)
+{
+    return _line(gpio);
+}
+
+void gpio_pull_up(uint gpio)
+{
+    // every line has a pull-up on it already (see _line())
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+    irq_callback = callback;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    memset(&host_flash[flash_offs], 0xff, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    memcpy(&host_flash[flash_offs], data, count);
+}
+
+// tinyusb
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t instance)
+{
+    int i = _interface(dev_addr, instance);
+
+    return (i < 0) ? HID_ITF_PROTOCOL_NONE : interfaces[i].protocol;
+}
+
+uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t *report_info_arr, uint8_t arr_count,
+    uint8_t const *desc_report, uint16_t desc_len)
+{
+    // tinyusb's parser, item for item: the usage page, usage and report id of each top level collection. it's
+    // bounded where tinyusb's isn't (an item running off the end, a three byte usage page), so anything the fuzzer
+    // finds past here is in the firmware, not in this stand-in.
+    tuh_hid_report_info_t *info = report_info_arr;
+    uint8_t report_num = 0, depth = 0, header, size;
+
+    memset(report_info_arr, 0, arr_count * sizeof(tuh_hid_report_info_t));
+
+    while (desc_len && (report_num < arr_count)) {
+        header = *desc_report++;
+        desc_len--;
+        size = header & 3;
+        if (size > desc_len)
+            break;
+
+        switch (header & 0xfc) {
+            case 0xa0:  // collection
+                depth++;
+                break;
+
+            case 0xc0:  // end collection
+                if (--depth == 0) {
+                    info++;
+                    report_num++;
+                }
+                break;
+
+            case 0x04:  // usage page
+                if (depth == 0)
+                    memcpy(&info->usage_page, desc_report, (size < sizeof(info->usage_page)) ? size : sizeof(info->usage_page));
+                break;
+
+            case 0x84:  // report id
+                if (size)
+                    info->report_id = desc_report[0];
+                break;
+
+            case 0x08:  // usage
+                if ((depth == 0) && size)
+                    info->usage = desc_report[0];
+                break;
+        }
+
+        desc_report += size;
+        desc_len -= size;
+    }
+
+    return report_num;
+}
+
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t instance)
+{
+    return true;
+}
+
+bool tuh_hid_set_protocol(uint8_t dev_addr, uint8_t instance, uint8_t protocol)
+{
+    int i = _interface(dev_addr, instance);
+
+    if (i < 0)
+        return false;
+
+    interfaces[i].hid_protocol = protocol;
+    return true;
+}
+
+uint8_t tuh_hid_get_protocol(uint8_t dev_addr, uint8_t instance)
+{
+    int i = _interface(dev_addr, instance);
+
+    return (i < 0) ? HID_PROTOCOL_BOOT : interfaces[i].hid_protocol;
+}
+
+bool tuh_hid_set_report(uint8_t dev_addr, uint8_t instance, uint8_t report_id, uint8_t report_type, void *report,
+    uint16_t len)
+{
+    // the only report the firmware sends a device is its leds; they're part of what's compared
+    printf("trace led %02x:%02x %02x\n", dev_addr, instance, len ? *(uint8_t *)report : 0);
+    return true;
+}
+
+bool tuh_vid_pid_get(uint8_t dev_addr, uint16_t *vid, uint16_t *pid)
+{
+    // no profile; every device gets the default
+    return false;
+}
+
+// the rest of the firmware, which the keyboard path calls but which isn't being replayed
+
+void dbgcons_plug(enum debug_plug_types devtype)
+{
+}
+
+void dbgcons_unplug(enum debug_plug_types devtype)
+{
+}
+
+void dbgcons_amiga_key(uint8_t incode, uint8_t outcode, char *updown)
+{
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    // the loop at entry never returns; its body, amiga_quad_mouse_service(), is run from host_advance_us() instead
+    core1_launched = true;
+    core1_at = now_us;
+}
+
+void amiga_joystick_set(uint8_t port, uint8_t state)
+{
+    printf("trace joy %u %02x\n", port, state);
+}
@@ -0,0 +1,88 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: controls for the simulated pico, usb stack and amiga.
+ */
+
+#ifndef _HOST_SDK_H
+#define _HOST_SDK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "pico.h"
+
+/**
+ * @brief Erase the simulated flash; call before anything else
+ */
+void host_init(void);
+
+/**
+ * @brief Move time on, running the transmitter and the amiga's handshakes as it passes
+ *
+ * @param us        Microseconds
+ */
+void host_advance_us(uint64_t us);
+
+/**
+ * @brief Plug in a usb interface, as tinyusb would
+ *
+ * @param dev_addr  Device address
+ * @param instance  Interface instance
+ * @param protocol  HID_ITF_PROTOCOL_NONE, _KEYBOARD or _MOUSE
+ * @param desc      Report descriptor, NULL for none
+ * @param desc_len  Length of the descriptor
+ */
+void host_mount(uint8_t dev_addr, uint8_t instance, uint8_t protocol, uint8_t const *desc, uint16_t desc_len);
+
+/**
+ * @brief Unplug a usb interface, as tinyusb would
+ *
+ * @param dev_addr  Device address
+ * @param instance  Interface instance
+ */
+void host_umount(uint8_t dev_addr, uint8_t instance);
+
+/**
+ * @brief Check the mouse ports: what the amiga's counters made of the edges on them against what the firmware says it
+ *        stepped out. prints each port's counters as "trace mouse", and anything amiss on stderr
+ *
+ * @return true     Every count asked for and not dropped reached the counters, one step at a time, and no frame
+ *                  carried more than a signed byte
+ * @return false    Something didn't
+ */
+bool host_mouse_check(void);
+
+/**
+ * @brief A line has changed level; the amiga's mouse ports take it from here (amiga_mouse.c)
+ *
+ * @param gpio      Pin
+ * @param level     Level now
+ */
+void host_mouse_edge(uint gpio, bool level);
+
+/**
+ * @brief Write every i2c transfer to a file from now on, for ssd_model.py (see i2c.c for the format)
+ *
+ * @param out       File, NULL to stop
+ */
+void host_i2c_capture(FILE *out);
+
+/**
+ * @brief When the i2c transfer on the wire finishes (i2c.c)
+ *
+ * @return uint64_t Time, UINT64_MAX if there isn't one or its interrupt is disabled
+ */
+uint64_t host_i2c_next(void);
+
+/**
+ * @brief Finish the i2c transfer on the wire, and interrupt the firmware to say so (i2c.c)
+ */
+void host_i2c_finish(void);
+
+#endif // _HOST_SDK_H
@@ -0,0 +1,164 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: the display's i2c controller, and the dma channel feeding it.
+ *
+ * each transfer the dma makes into a controller's data_cmd register is written out word for word, flags and all, to
+ * the capture file given to host_i2c_capture(), for ssd_model.py to make what the display would show of. the transfer
+ * then takes as long as it would on the wire (nine clocks a byte, the address included, plus start and stop), and
+ * when it's over the controller raises stop detected for the firmware's interrupt handler.
+ *
+ * a capture has a line per transfer: the time it started in microseconds, the target address and then each data_cmd
+ * word, all but the time in hex.
+ */
+
+#include "host_sdk.h"
+
+#include <stdio.h>
+
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "pico/time.h"
+
+i2c_inst_t host_i2c[2];
+
+static FILE *capture = NULL;
+
+// the controllers' interrupts
+static irq_handler_t irq_handlers[2];
+static bool irq_enabled[2];
+
+// the transfer on the wire, and when it'll be done
+static i2c_inst_t *busy = NULL;
+static uint64_t busy_until = 0;
+
+static uint32_t dma_claimed = 0;
+
+/**
+ * Put a transfer on the wire
+ *
+ * @param i2c       Controller
+ * @param words     data_cmd words
+ * @param count     Number of them
+ * @return uint64_t How long it takes, in microseconds
+ */
+static uint64_t _i2c_transfer(i2c_inst_t *i2c, const volatile uint16_t *words, uint count)
+{
+    uint64_t clocks = (9 * (count + 1)) + 2;
+    uint baudrate = i2c->baudrate ? i2c->baudrate : 100000;
+
+    if (capture != NULL) {
+        fprintf(capture, "%llu %02x", (unsigned long long)time_us_64(), (unsigned)(i2c->hw.tar & 0x7f));
+        for (uint i = 0; i < count; i++)
+            fprintf(capture, " %03x", words[i]);
+        fprintf(capture, "\n");
+    }
+
+    return (clocks * 1000000) / baudrate;
+}
+
+void host_i2c_capture(FILE *out)
+{
+    capture = out;
+}
+
+uint64_t host_i2c_next(void)
+{
+    if ((busy == NULL) || !irq_enabled[busy == i2c1])
+        return UINT64_MAX;
+
+    return busy_until;
+}
+
+void host_i2c_finish(void)
+{
+    i2c_inst_t *i2c = busy;
+
+    // the handler may well start the next transfer
+    busy = NULL;
+    i2c->hw.intr_stat = I2C_IC_INTR_STAT_R_STOP_DET_BITS;
+    if (irq_handlers[i2c == i2c1])
+        irq_handlers[i2c == i2c1]();
+    i2c->hw.intr_stat = 0;
+}
+
+// pico sdk
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    if (!len)
+        return 0;
+
+    uint16_t words[len];
+
+    // the display is always there to ack it
+    for (size_t i = 0; i < len; i++)
+        words[i] = src[i];
+    words[0] |= I2C_IC_DATA_CMD_RESTART_BITS;
+    if (!nostop)
+        words[len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    i2c->hw.tar = addr;
+    _i2c_transfer(i2c, words, len);
+
+    return len;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+    const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+    for (uint8_t i = 0; i < 2; i++) {
+        if (!trigger || (write_addr != &host_i2c[i].hw.data_cmd) || (config->size != DMA_SIZE_16))
+            continue;
+
+        busy = &host_i2c[i];
+        busy_until = time_us_64() + _i2c_transfer(busy, read_addr, transfer_count);
+    }
+}
+
+void dma_channel_abort(uint channel)
+{
+}
+
+int dma_claim_unused_channel(bool required)
+{
+    for (int channel = 0; channel < 12; channel++) {
+        if (!(dma_claimed & (1u << channel))) {
+            dma_claimed |= 1u << channel;
+            return channel;
+        }
+    }
+
+    if (required)
+        panic("no dma channels left\n");
+
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    dma_claimed &= ~(1u << channel);
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    if ((num == I2C0_IRQ) || (num == I2C1_IRQ))
+        irq_handlers[num == I2C1_IRQ] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    if ((num == I2C0_IRQ) || (num == I2C1_IRQ))
+        irq_enabled[num == I2C1_IRQ] = enabled;
+}
@@ -0,0 +1,32 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: the parts of the pico sdk the keyboard path uses, just enough to build it on a pc (see host_sdk.c).
+ */
+
+#ifndef _HOST_PICO_H
+#define _HOST_PICO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#define PICO_ERROR_GENERIC  -1
+
+// there's no flash to keep things out of on a pc
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+
+// a microsecond goes by each time round a busy wait, or a poll of a pin would never time out; in the main loop, the
+// alarm and the rest run meanwhile, as their interrupts would (see host_sdk.c)
+void tight_loop_contents(void);
+
+void panic(const char *fmt, ...);
+
+#endif // _HOST_PICO_H
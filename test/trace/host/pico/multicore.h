@@ -0,0 +1,21 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: pico/multicore.h. there's only the one core; what core1 would run, host_advance_us() runs in between
+ * everything else.
+ */
+
+#ifndef _HOST_PICO_MULTICORE_H
+#define _HOST_PICO_MULTICORE_H
+
+void multicore_launch_core1(void (*entry)(void));
+
+static inline void multicore_lockout_victim_init(void) {}
+static inline void multicore_lockout_start_blocking(void) {}
+static inline void multicore_lockout_end_blocking(void) {}
+
+#endif // _HOST_PICO_MULTICORE_H
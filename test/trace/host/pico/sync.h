@@ -0,0 +1,25 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: pico/sync.h. core1's work is run from the same thread as core0's, so a critical section has nothing to
+ * keep out.
+ */
+
+#ifndef _HOST_PICO_SYNC_H
+#define _HOST_PICO_SYNC_H
+
+#include "hardware/sync.h"
+
+typedef struct {
+    int unused;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *crit_sec) { (void)crit_sec; }
+static inline void critical_section_enter_blocking(critical_section_t *crit_sec) { (void)crit_sec; }
+static inline void critical_section_exit(critical_section_t *crit_sec) { (void)crit_sec; }
+
+#endif // _HOST_PICO_SYNC_H
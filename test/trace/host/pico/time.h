@@ -0,0 +1,23 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: pico/time.h. time is simulated; it only moves when the replay says so (see host_advance_us()).
+ */
+
+#ifndef _HOST_PICO_TIME_H
+#define _HOST_PICO_TIME_H
+
+#include "pico.h"
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+
+#endif // _HOST_PICO_TIME_H
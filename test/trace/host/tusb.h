@@ -0,0 +1,44 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * host build: the tinyusb host api the firmware calls. the replay stands in for the usb stack (see host_sdk.c).
+ */
+
+#ifndef _HOST_TUSB_H
+#define _HOST_TUSB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define OPT_MODE_DEFAULT_SPEED  0
+#define OPT_OS_NONE             1
+
+#include "tusb_config.h"
+#include "class/hid/hid.h"
+
+typedef struct {
+    uint8_t report_id;
+    uint8_t usage;
+    uint16_t usage_page;
+} tuh_hid_report_info_t;
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t instance);
+uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t *report_info_arr, uint8_t arr_count,
+    uint8_t const *desc_report, uint16_t desc_len);
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t instance);
+bool tuh_hid_set_protocol(uint8_t dev_addr, uint8_t instance, uint8_t protocol);
+uint8_t tuh_hid_get_protocol(uint8_t dev_addr, uint8_t instance);
+bool tuh_hid_set_report(uint8_t dev_addr, uint8_t instance, uint8_t report_id, uint8_t report_type, void *report,
+    uint16_t len);
+bool tuh_vid_pid_get(uint8_t dev_addr, uint16_t *vid, uint16_t *pid);
+
+// the callbacks tinyusb makes into the firmware
+void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const *desc_report, uint16_t desc_len);
+void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance);
+void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len);
+
+#endif // _HOST_TUSB_H
@@ -0,0 +1,38 @@
+# replays one case and compares its trace with the golden file next to it; run by ctest, see CMakeLists.txt.
+#
+#   REPLAY  trace_replay executable
+#   CASE    case file, cases/<name>.hid
+#   OUTPUT  where to leave <name>.actual when it doesn't match
+#   UPDATE  set to write the golden file instead of comparing with it
+
+get_filename_component(name ${CASE} NAME_WE)
+get_filename_component(dir ${CASE} DIRECTORY)
+set(golden ${dir}/${name}.golden)
+
+execute_process(
+  COMMAND ${REPLAY} ${CASE}
+  OUTPUT_VARIABLE output
+  RESULT_VARIABLE result
+)
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "${name}: replay failed (${result})")
+endif ()
+
+# only the trace lines are compared; any other debug output is free to change
+string(REGEX MATCHALL "trace [^\n]*\n" lines "${output}")
+string(CONCAT trace ${lines})
+
+if (UPDATE)
+  file(WRITE ${golden} "${trace}")
+  return()
+endif ()
+
+if (NOT EXISTS ${golden})
+  message(FATAL_ERROR "${name}: no golden file; build the update-traces target to make one")
+endif ()
+
+file(READ ${golden} expected)
+if (NOT trace STREQUAL expected)
+  file(WRITE ${OUTPUT}/${name}.actual "${trace}")
+  message(FATAL_ERROR "${name}: trace differs from ${golden}; what was sent is in ${OUTPUT}/${name}.actual")
+endif ()
@@ -0,0 +1,47 @@
+# replays one display case with the i2c transfers captured, runs them through ssd_model.py, and compares what it
+# reports of each refresh with the golden file next to the case; run by ctest, see CMakeLists.txt.
+#
+#   REPLAY  trace_replay executable
+#   MODEL   ssd_model.py
+#   PYTHON  python interpreter
+#   CASE    case file, cases/display/<name>.hid
+#   OUTPUT  where to leave the capture, <name>/frame-<n>.png and, when it doesn't match, <name>.actual
+#   UPDATE  set to write the golden file instead of comparing with it
+
+get_filename_component(name ${CASE} NAME_WE)
+get_filename_component(dir ${CASE} DIRECTORY)
+set(golden ${dir}/${name}.frames)
+
+execute_process(
+  COMMAND ${REPLAY} ${CASE} ${OUTPUT}/${name}.i2c
+  OUTPUT_QUIET
+  RESULT_VARIABLE result
+)
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "${name}: replay failed (${result})")
+endif ()
+
+execute_process(
+  COMMAND ${PYTHON} ${MODEL} -p ${OUTPUT}/${name} ${OUTPUT}/${name}.i2c
+  OUTPUT_VARIABLE frames
+  RESULT_VARIABLE result
+)
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "${name}: ssd_model.py failed (${result})")
+endif ()
+
+if (UPDATE)
+  file(WRITE ${golden} "${frames}")
+  return()
+endif ()
+
+if (NOT EXISTS ${golden})
+  message(FATAL_ERROR "${name}: no golden file; build the update-traces target to make one")
+endif ()
+
+file(READ ${golden} expected)
+if (NOT frames STREQUAL expected)
+  file(WRITE ${OUTPUT}/${name}.actual "${frames}")
+  message(FATAL_ERROR "${name}: refreshes differ from ${golden}; the model's are in ${OUTPUT}/${name}.actual and the "
+    "frames as drawn in ${OUTPUT}/${name}")
+endif ()
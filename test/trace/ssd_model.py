@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+#
+# this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+# please locate the full source at https://github.com/borb/amigahid-pico
+#
+# released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+# please find the complete license text at https://spdx.org/licenses/EPL-2.0
+#
+# ssd1306 model: takes the i2c data_cmd words trace_replay captures on its way to the display (see host/i2c.c) and
+# interprets them the way the controller does (control bytes, commands and their arguments, the three addressing
+# modes and the column/page window) into its gddram. a refresh is everything up to and including a transfer of
+# gddram data; for each one it prints the bytes on the wire and the bus time they take, and optionally writes what the
+# gddram then holds as a png, in the framebuffer's orientation (x across, y down, as ugui drew it).
+#
+# usage: ssd_model.py [-b baud] [-p dir [-s scale]] capture
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+WIDTH = 128
+PAGES = 8
+
+DATA_CMD_RESTART = 0x400
+DATA_CMD_STOP = 0x200
+DATA_CMD_READ = 0x100
+
+# commands which take arguments, and how many
+ARGUMENTS = {
+    0x20: 1,    # addressing mode
+    0x21: 2,    # column address
+    0x22: 2,    # page address
+    0x26: 6,    # horizontal scroll setup
+    0x27: 6,
+    0x29: 5,    # vertical & horizontal scroll setup
+    0x2a: 5,
+    0x81: 1,    # contrast
+    0x8d: 1,    # charge pump
+    0xa3: 2,    # vertical scroll area
+    0xa8: 1,    # mux ratio
+    0xd3: 1,    # display offset
+    0xd5: 1,    # clock divide & oscillator
+    0xd9: 1,    # precharge period
+    0xda: 1,    # com pins
+    0xdb: 1,    # vcomh deselect
+}
+
+HORIZONTAL, VERTICAL, PAGE = 0, 1, 2
+
+
+class CaptureError(Exception):
+    pass
+
+
+class Ssd1306:
+    def __init__(self):
+        self.gddram = [bytearray(WIDTH) for _ in range(PAGES)]
+        self.mode = PAGE        # power-on default
+        self.col_start, self.col_end = 0, WIDTH - 1
+        self.page_start, self.page_end = 0, PAGES - 1
+        self.col = self.page = 0
+        self.command = None
+        self.args = []
+        self.on = False
+        self.wrapped = False    # the address pointer went back to the start of the window in this transfer
+        self.overran = False    # and then went on writing, over its own earlier bytes
+        self.overruns = 0       # transfers which did
+        self.pages_written = set()
+
+    def _apply(self):
+        command, args = self.command, self.args
+        if command < 0x20 or (command & 0xf8) == 0xb0 or command in (0x20, 0x21, 0x22):
+            self.wrapped = False
+
+        if command < 0x10:
+            # page addressing mode: lower column nibble
+            self.col = (self.col & 0xf0) | command
+        elif command < 0x20:
+            # page addressing mode: upper column nibble
+            self.col = (self.col & 0x0f) | ((command & 0x07) << 4)
+        elif (command & 0xf8) == 0xb0:
+            # page addressing mode: page start
+            self.page = command & 0x07
+        elif command in (0xae, 0xaf):
+            self.on = command == 0xaf
+        elif command == 0x20:
+            self.mode = min(args[0] & 0x03, PAGE)
+        elif command == 0x21:
+            self.col = self.col_start = args[0] & 0x7f
+            self.col_end = args[1] & 0x7f
+        elif command == 0x22:
+            self.page = self.page_start = args[0] & 0x07
+            self.page_end = args[1] & 0x07
+
+    def command_byte(self, byte):
+        if self.command is not None and len(self.args) < ARGUMENTS.get(self.command, 0):
+            self.args.append(byte)
+        else:
+            self.command, self.args = byte, []
+
+        if len(self.args) == ARGUMENTS.get(self.command, 0):
+            self._apply()
+
+    def data_byte(self, byte):
+        if self.wrapped:
+            self.overran = True
+
+        self.gddram[self.page][self.col] = byte
+        self.pages_written.add(self.page)
+
+        if self.mode == HORIZONTAL:
+            if self.col < self.col_end:
+                self.col += 1
+                return
+            self.col = self.col_start
+            if self.page < self.page_end:
+                self.page += 1
+                return
+            self.page = self.page_start
+            self.wrapped = True
+        elif self.mode == VERTICAL:
+            if self.page < self.page_end:
+                self.page += 1
+                return
+            self.page = self.page_start
+            if self.col < self.col_end:
+                self.col += 1
+                return
+            self.col = self.col_start
+            self.wrapped = True
+        else:
+            if self.col < WIDTH - 1:
+                self.col += 1
+                return
+            self.col = 0
+            self.wrapped = True
+
+    def transfer(self, payload):
+        # a control byte (co: bit 7, d/c#: bit 6) then one byte if co is set, or the rest of the transfer if not
+        data = False
+        pos = 0
+        self.wrapped = self.overran = False
+        while pos < len(payload):
+            control = payload[pos]
+            pos += 1
+            take = 1 if control & 0x80 else len(payload) - pos
+            for byte in payload[pos:pos + take]:
+                if control & 0x40:
+                    data = True
+                    self.data_byte(byte)
+                else:
+                    self.command_byte(byte)
+            pos += take
+
+        if self.overran:
+            self.overruns += 1
+        return data
+
+    def png(self, path, scale):
+        rows = []
+        for y in range(PAGES * 8):
+            bits = [(self.gddram[y // 8][x] >> (y % 8)) & 1 for x in range(WIDTH) for _ in range(scale)]
+            row = bytes(
+                int(''.join(map(str, bits[pos:pos + 8])), 2) for pos in range(0, len(bits), 8)
+            )
+            rows.extend([b'\x00' + row] * scale)
+
+        def chunk(kind, body):
+            return struct.pack('>I', len(body)) + kind + body + struct.pack('>I', zlib.crc32(kind + body))
+
+        with open(path, 'wb') as output:
+            output.write(b'\x89PNG\r\n\x1a\n')
+            # one bit greyscale: a lit pixel is white
+            output.write(chunk(b'IHDR', struct.pack('>IIBBBBB', WIDTH * scale, PAGES * 8 * scale, 1, 0, 0, 0, 0)))
+            output.write(chunk(b'IDAT', zlib.compress(b''.join(rows), 9)))
+            output.write(chunk(b'IEND', b''))
+
+
+def transfers(path):
+    with open(path) as capture:
+        for number, line in enumerate(capture, 1):
+            fields = line.split()
+            if not fields:
+                continue
+            try:
+                at, address, words = int(fields[0]), int(fields[1], 16), [int(word, 16) for word in fields[2:]]
+            except (ValueError, IndexError):
+                raise CaptureError(f'{path}:{number}: not a transfer')
+
+            if not words or not words[0] & DATA_CMD_RESTART or words[-1] & DATA_CMD_STOP != DATA_CMD_STOP:
+                raise CaptureError(f'{path}:{number}: transfer without a start and a stop')
+            if any(word & DATA_CMD_STOP for word in words[:-1]) or any(word & DATA_CMD_RESTART for word in words[1:]):
+                raise CaptureError(f'{path}:{number}: more than one transfer in a line')
+            if any(word & DATA_CMD_READ for word in words):
+                raise CaptureError(f'{path}:{number}: reads from the display aren\'t modelled')
+
+            yield at, address, bytes(word & 0xff for word in words)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='model an ssd1306 from a captured i2c data_cmd stream')
+    parser.add_argument('-b', '--baud', type=int, default=1000000, help='i2c clock (SSD_BAUD in disp_ssd.c)')
+    parser.add_argument('-a', '--address', type=lambda value: int(value, 0), default=0x3c, help='display address')
+    parser.add_argument('-p', '--png', help='directory to write each refresh to, as frame-<n>.png')
+    parser.add_argument('-s', '--scale', type=int, default=4, help='pixels per display pixel in the png')
+    parser.add_argument('capture', help='capture from trace_replay')
+    args = parser.parse_args()
+
+    display = Ssd1306()
+    frames = 0
+    start = count = wire = bus_us = 0
+
+    if args.png:
+        os.makedirs(args.png, exist_ok=True)
+
+    try:
+        for at, address, payload in transfers(args.capture):
+            if address != args.address:
+                continue
+
+            # as disp_ssd.c accounts it: nine clocks a byte, the address included, plus start and stop
+            if not count:
+                start = at
+            count += 1
+            wire += len(payload) + 1
+            bus_us += ((9 * (len(payload) + 1)) + 2) * 1000000 // args.baud
+
+            overruns, on = display.overruns, display.on
+            display.pages_written.clear()
+            if not display.transfer(payload):
+                # the init sequence ends by switching the display on; it's no part of the first refresh
+                if not frames and display.on and not on:
+                    print(f'init at {start} us: {count} transfers, {wire} bytes, {bus_us} us')
+                    count = wire = bus_us = 0
+                continue
+
+            frames += 1
+            pages = sorted(display.pages_written)
+            gddram = zlib.crc32(b''.join(display.gddram))
+            print(
+                f'frame {frames} at {start} us: {count} transfer{"" if count == 1 else "s"}, {wire} bytes, {bus_us} us,'
+                f' pages {pages[0]}-{pages[-1]}{", overran the window" if display.overruns != overruns else ""}, gddram {gddram:08x}'
+            )
+            if args.png:
+                display.png(os.path.join(args.png, f'frame-{frames}.png'), args.scale)
+            count = wire = bus_us = 0
+    except (CaptureError, OSError) as error:
+        sys.exit(f'ssd_model: {error}')
+
+    # commands after the last refresh, such as the init sequence on a display nothing was drawn on
+    if count:
+        print(f'no refresh from {start} us: {count} transfers, {wire} bytes, {bus_us} us')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,170 @@
+/**
+ * this file is part of amigahid-pico, (c) 2021 just nine <nine@aphlor.org>
+ * please locate the full source at https://github.com/borb/amigahid-pico
+ *
+ * released under the terms of the Eclipse Public License 2.0 (EPL-2.0).
+ * please find the complete license text at https://spdx.org/licenses/EPL-2.0
+ *
+ * keyboard trace replay: feeds a recorded sequence of usb hid reports through the firmware's own keyboard path on a
+ * pc, and prints the same "trace " lines the firmware does with TRACE_KEYBOARD (plus "trace led" for each led report
+ * sent back to a keyboard, "trace joy" and "trace button" for the controller ports' lines, and at the end "trace mouse"
+ * for where the amiga's mouse counters got to).
+ * run_case.cmake compares them with a golden file.
+ *
+ * a case is a text file, one step per line; # starts a comment.
+ *
+ *   mount <dev> <instance> kbd|mouse   plug in a boot protocol interface
+ *   mount <dev> <instance> kbd|mouse|none <hex>...
+ *                                      the same, with a report descriptor (none for an interface without a boot
+ *                                      protocol, such as a gamepad)
+ *   umount <dev> <instance>            unplug it
+ *   report <dev> <instance> <hex>...   a report from it, as tinyusb hands it over
+ *   raw <code> d|u                     an amiga keycode straight into amiga_send(), as the passthrough sends them
+ *   wait <ms>                          run the main loop for that long, a pass every millisecond
+ *   disp <x> <y> <text>                write text on the display, as the debug console does
+ *   refresh <first> <last>             send that range of pages to the display, as amigahid-bench does
+ *   macro <modifier> <key> <step>...   define a macro on a hid key, steps in hex as the uart's m command takes them
+ *   save                               save the macros to flash; prints "trace save ok" or "trace save err"
+ *
+ * given a second file, every i2c transfer to the display is written to it for ssd_model.py (see host/i2c.c).
+ */
+
+#include "host_sdk.h"
+#include "platform/platform.h"
+#include "platform/amiga/keyboard_serial_io.h"
+#include "platform/amiga/macro.h"
+#include "display/disp_ssd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tusb.h"
+
+// longest the power-up handshake may take before the case starts
+#define REPLAY_READY_MS     5000
+
+// what's left running after the last step, so a macro or a backlog plays out
+#define REPLAY_TAIL_MS      500
+
+/**
+ * Run the main loop
+ *
+ * @param ms        Milliseconds
+ */
+static void _replay_wait(uint32_t ms)
+{
+    while (ms--) {
+        platform_service();
+        host_advance_us(1000);
+    }
+}
+
+/**
+ * Read a number from the rest of a line
+ *
+ * @param value     Where to put it
+ * @param base      10 or 16
+ * @return true     Got one
+ * @return false    Nothing (more) there
+ */
+static bool _replay_number(unsigned long *value, int base)
+{
+    char *token = strtok(NULL, " \t\r\n"), *end;
+
+    if (token == NULL)
+        return false;
+
+    *value = strtoul(token, &end, base);
+    return *end == '\0';
+}
+
+int main(int argc, char **argv)
+{
+    char line[1024], *step;
+    uint8_t report[64], desc[256];
+    uint16_t steps[64];
+    unsigned long dev, instance, value, modifier, key;
+    uint16_t len;
+    uint8_t protocol;
+    uint32_t number = 0;
+    FILE *input, *capture = NULL;
+
+    if ((argc < 2) || (argc > 3) || ((input = fopen(argv[1], "r")) == NULL)
+        || ((argc == 3) && ((capture = fopen(argv[2], "w")) == NULL))) {
+        fprintf(stderr, "usage: trace_replay <case> [<i2c capture>]\n");
+        return 2;
+    }
+
+    host_init();
+    host_i2c_capture(capture);
+    platform_init();
+    disp_ssd_init();
+
+    // the amiga has to be listening before anything typed reaches it
+    for (value = 0; !amiga_ready_us() && (value < REPLAY_READY_MS); value++)
+        _replay_wait(1);
+
+    while (fgets(line, sizeof(line), input) != NULL) {
+        number++;
+        if ((step = strchr(line, '#')) != NULL)
+            *step = '\0';
+        if ((step = strtok(line, " \t\r\n")) == NULL)
+            continue;
+
+        if (!strcmp(step, "mount") && _replay_number(&dev, 10) && _replay_number(&instance, 10)) {
+            step = strtok(NULL, " \t\r\n");
+            if ((step != NULL) && (!strcmp(step, "kbd") || !strcmp(step, "mouse") || !strcmp(step, "none"))) {
+                protocol = !strcmp(step, "kbd") ? HID_ITF_PROTOCOL_KEYBOARD
+                    : !strcmp(step, "mouse") ? HID_ITF_PROTOCOL_MOUSE : HID_ITF_PROTOCOL_NONE;
+                for (len = 0; (len < sizeof(desc)) && _replay_number(&value, 16); len++)
+                    desc[len] = value;
+                host_mount(dev, instance, protocol, len ? desc : NULL, len);
+                continue;
+            }
+        } else if (!strcmp(step, "umount") && _replay_number(&dev, 10) && _replay_number(&instance, 10)) {
+            host_umount(dev, instance);
+            continue;
+        } else if (!strcmp(step, "report") && _replay_number(&dev, 10) && _replay_number(&instance, 10)) {
+            for (len = 0; (len < sizeof(report)) && _replay_number(&value, 16); len++)
+                report[len] = value;
+            tuh_hid_report_received_cb(dev, instance, report, len);
+            continue;
+        } else if (!strcmp(step, "raw") && _replay_number(&value, 16)) {
+            step = strtok(NULL, " \t\r\n");
+            if ((step != NULL) && (!strcmp(step, "d") || !strcmp(step, "u"))) {
+                amiga_send(value, !strcmp(step, "u"));
+                continue;
+            }
+        } else if (!strcmp(step, "wait") && _replay_number(&value, 10)) {
+            _replay_wait(value);
+            continue;
+        } else if (!strcmp(step, "disp") && _replay_number(&dev, 10) && _replay_number(&value, 10)) {
+            step = strtok(NULL, "\r\n");
+            disp_write(dev, value, (step != NULL) ? step : "");
+            continue;
+        } else if (!strcmp(step, "refresh") && _replay_number(&dev, 10) && _replay_number(&value, 10)) {
+            disp_ssd_refresh(dev, value);
+            continue;
+        } else if (!strcmp(step, "macro") && _replay_number(&modifier, 16) && _replay_number(&key, 16)) {
+            for (len = 0; (len < (sizeof(steps) / sizeof(steps[0]))) && _replay_number(&value, 16); len++)
+                steps[len] = value;
+            if (amiga_macro_define(modifier, key, steps, len))
+                continue;
+        } else if (!strcmp(step, "save")) {
+            printf("trace save %s\n", amiga_macro_save() ? "ok" : "err");
+            continue;
+        }
+
+        fprintf(stderr, "%s:%lu: can't make sense of this step\n", argv[1], (unsigned long)number);
+        return 2;
+    }
+
+    _replay_wait(REPLAY_TAIL_MS);
+    fclose(input);
+    if (capture != NULL)
+        fclose(capture);
+
+    // by now any motion has played out; a count which didn't reach the amiga's counters intact fails the case
+    return host_mouse_check() ? 0 : 1;
+}